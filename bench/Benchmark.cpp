@@ -0,0 +1,150 @@
+#include "Benchmark.h"
+
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <ctime>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifndef CANVIS_VERSION
+#define CANVIS_VERSION "unknown"
+#endif
+
+static std::atomic<uint64_t> allocationCount{0};
+
+// Counts every allocation of the process, the default array forms forward here. Over-aligned
+// allocations keep the default operators and are not counted.
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1)) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+uint64_t Bench::allocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+#ifdef _MSC_VER
+void Bench::escape(const volatile char*) {}
+#endif
+
+Bench::Suite::Suite(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc) minTime = std::stod(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) output = argv[++i];
+    }
+}
+
+bool Bench::Suite::enabled(const std::string& name) const {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+Bench::Result* Bench::Suite::run(const std::string& name, const std::function<uint64_t(uint64_t)>& body) {
+    if (!enabled(name)) return nullptr;
+
+    auto time = [&](uint64_t iterations, uint64_t& items) {
+        auto start = std::chrono::steady_clock::now();
+        items = body(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // Grow the iteration count until one run takes a tenth of the target time
+    uint64_t iterations = 1;
+    uint64_t items = 0;
+    double elapsed = time(iterations, items);
+    while (elapsed < minTime / 10 && iterations < (1ULL << 40)) {
+        iterations *= elapsed > 0 ? std::max<uint64_t>(2, static_cast<uint64_t>(minTime / 10 / elapsed)) : 10;
+        elapsed = time(iterations, items);
+    }
+    iterations = std::max<uint64_t>(1, static_cast<uint64_t>(iterations * minTime / std::max(elapsed, 1e-9)));
+
+    std::vector<double> nsPerOp;
+    std::vector<double> itemsPerSecond;
+    uint64_t allocated = allocations();
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        elapsed = time(iterations, items);
+        nsPerOp.push_back(elapsed * 1e9 / iterations);
+        itemsPerSecond.push_back(items / elapsed);
+    }
+    allocated = allocations() - allocated;
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    std::sort(itemsPerSecond.begin(), itemsPerSecond.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp[2];
+    result.itemsPerSecond = itemsPerSecond[2];
+    result.allocationsPerOp = static_cast<double>(allocated) / (5 * iterations);
+    results.push_back(result);
+
+    std::cerr << std::left << std::setw(40) << name << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+              << result.nsPerOp << " ns/op" << std::setw(16) << std::setprecision(0) << result.itemsPerSecond << " items/s"
+              << std::setw(12) << std::setprecision(3) << result.allocationsPerOp << " allocs/op" << std::endl;
+    return &results.back();
+}
+
+void Bench::Suite::counter(const std::string& name, double value) {
+    if (results.empty()) return;
+    results.back().counters[name] = value;
+    std::cerr << "    " << name << " = " << value << std::endl;
+}
+
+static std::string escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+int Bench::Suite::finish() const {
+    std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::ostringstream json;
+    json << std::setprecision(6);
+    json << "{\n  \"version\": \"" << escape(CANVIS_VERSION) << "\",\n  \"date\": \"" << date << "\",\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        json << (i ? ",\n" : "\n") << "    {\"name\": \"" << escape(result.name) << "\", \"iterations\": " << result.iterations
+             << ", \"ns_per_op\": " << result.nsPerOp << ", \"items_per_second\": " << result.itemsPerSecond
+             << ", \"allocs_per_op\": " << result.allocationsPerOp;
+        if (!result.counters.empty()) {
+            json << ", \"counters\": {";
+            bool first = true;
+            for (const auto& [name, value] : result.counters) {
+                json << (first ? "" : ", ") << "\"" << escape(name) << "\": " << value;
+                first = false;
+            }
+            json << "}";
+        }
+        json << "}";
+    }
+    json << "\n  ]\n}\n";
+
+    if (output.empty()) {
+        std::cout << json.str();
+        return 0;
+    }
+
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file: " << output << std::endl;
+        return 1;
+    }
+    file << json.str();
+    return 0;
+}
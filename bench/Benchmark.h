@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Bench {
+    struct Result;
+    class Suite;
+
+    // Calls of the global operator new so far, counted by the suite's replacement of it
+    uint64_t allocations();
+
+#ifdef _MSC_VER
+    // Defined in another translation unit, so the compiler cannot see that it does nothing
+    void escape(const volatile char* pointer);
+#endif
+
+    // Keeps the compiler from discarding a computed value, without a store of its own
+    template <typename T>
+    void doNotOptimize(const T& value) {
+#ifdef _MSC_VER
+        escape(&reinterpret_cast<const volatile char&>(value));
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "g"(&value) : "memory");
+#endif
+    }
+}
+
+struct Bench::Result {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0;
+    double itemsPerSecond = 0;
+    double allocationsPerOp = 0; // Over the timed runs
+    std::map<std::string, double> counters;
+};
+
+// Runs each benchmark for at least minTime seconds, five times, and reports the median.
+// Usage: canvis_bench [--filter <substring>] [--min-time <s>] [--out <file.json>]
+class Bench::Suite {
+private:
+    std::vector<Result> results;
+    std::string filter;
+    std::string output;
+    double minTime = 0.2;
+
+public:
+    Suite(int argc, char** argv);
+
+    bool enabled(const std::string& name) const;
+
+    // body(iterations) runs the operation iterations times and returns the number of items processed
+    Result* run(const std::string& name, const std::function<uint64_t(uint64_t)>& body);
+    // Extra value reported with the last benchmark
+    void counter(const std::string& name, double value);
+
+    // Writes the JSON report, returns the process exit code
+    int finish() const;
+};
@@ -0,0 +1,564 @@
+#include "Benchmark.h"
+
+#include "CAN.h"
+#include "MessageBuffer.h"
+#include "Synthetic.h"
+#include "Statistics.h"
+#include "Filter.h"
+#include "MathChannel.h"
+#include "Codec.h"
+#include "Clock.h"
+#include "Database.h"
+#include "Spectrum.h"
+
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Frames of the generator, each paired with its description
+struct Traffic {
+    CAN::Database database;
+    CAN::DatabaseStore store;
+    std::vector<CAN::Frame> frames;
+
+    Traffic(const CAN::SyntheticOptions& options, size_t count) : database(CAN::syntheticDatabase(options)), store(database) {
+        CAN::SyntheticGenerator generator(database);
+        frames.resize(count);
+        generator.fill(frames.data(), count);
+    }
+
+    const CAN::MessageDescription* describe(const CAN::Frame& frame) const {
+        auto it = database.find(frame.id);
+        return it != database.end() ? &it->second : nullptr;
+    }
+};
+
+static void benchMessage(Bench::Suite& suite) {
+    CAN::SyntheticOptions classic;
+    classic.messages = 64;
+    classic.signalsPerMessage = 8;
+    Traffic classicTraffic(classic, 4096);
+
+    CAN::SyntheticOptions fd = classic;
+    fd.signalsPerMessage = 32;
+    fd.fdRatio = 1.0;
+    Traffic fdTraffic(fd, 4096);
+
+    for (auto [name, traffic] : {std::pair{"classic_8sig", &classicTraffic}, std::pair{"fd_32sig", &fdTraffic}}) {
+        suite.run(std::string("message/construct_raw/") + name, [traffic = traffic](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                CAN::Message message(traffic->frames[i % traffic->frames.size()]);
+                Bench::doNotOptimize(message.rawData.size());
+            }
+            return iterations;
+        });
+
+        suite.run(std::string("message/construct_decode/") + name, [traffic = traffic](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                const CAN::Frame& frame = traffic->frames[i % traffic->frames.size()];
+                CAN::Message message(frame, traffic->describe(frame));
+                Bench::doNotOptimize(message.decodedData.size());
+            }
+            return iterations;
+        });
+
+        // Decode into an existing message, the per frame cost of signal extraction alone
+        std::vector<CAN::Message> messages(traffic->frames.begin(), traffic->frames.begin() + 256);
+        suite.run(std::string("message/decode/") + name, [traffic = traffic, &messages](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                CAN::Message& message = messages[i % messages.size()];
+                message.decode(*traffic->describe(traffic->frames[i % messages.size()]));
+            }
+            return iterations;
+        });
+
+        std::vector<double> values(64, 1.0);
+        suite.run(std::string("message/encode/") + name, [traffic = traffic, &values](uint64_t iterations) {
+            CAN::Frame frame{};
+            for (uint64_t i = 0; i < iterations; ++i) {
+                CAN::Message::encode(*traffic->describe(traffic->frames[i % traffic->frames.size()]), values.data(), frame);
+                Bench::doNotOptimize(frame.data[0]);
+            }
+            return iterations;
+        });
+    }
+
+    CAN::SyntheticOptions mixed = classic;
+    mixed.fdRatio = 0.25;
+    Traffic mixedTraffic(mixed, 4096);
+    suite.run("message/frame_time/mixed_fd25", [&](uint64_t iterations) {
+        double total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) total += CAN::frameTime(mixedTraffic.frames[i % mixedTraffic.frames.size()], 500000, 2000000);
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+}
+
+static void benchFilter(Bench::Suite& suite) {
+    CAN::SyntheticOptions options;
+    options.messages = 200;
+    Traffic traffic(options, 4096);
+    std::string signal = traffic.database.begin()->second.name + "." + traffic.database.begin()->second.signals[0].name;
+
+    const std::pair<const char*, std::string> filters[] = {
+        {"id_range", "id in 0x100..0x17F"},
+        {"id_mask_data", "id & 0x7F0 == 0x120 || (dlc == 8 && data[0] & 0x0F != 0)"},
+        {"signal", signal + " >= 0"},
+    };
+    for (const auto& [name, expression] : filters) {
+        CAN::Filter filter(expression, &traffic.database);
+        suite.run(std::string("filter/matches/") + name, [&traffic, filter](uint64_t iterations) {
+            size_t total = 0;
+            for (uint64_t i = 0; i < iterations; ++i) total += filter.matches(traffic.frames[i % traffic.frames.size()]);
+            Bench::doNotOptimize(total);
+            return iterations;
+        });
+    }
+}
+
+static void benchMathChannel(Bench::Suite& suite) {
+    CAN::SyntheticOptions options;
+    options.messages = 8;
+    Traffic traffic(options, 1 << 16);
+    auto signal = [&](size_t message, size_t index) {
+        return std::next(traffic.database.begin(), message)->second.signals[index].name;
+    };
+
+    // Items are frames, inputs from two messages of eight are sampled and held
+    const std::pair<const char*, std::string> channels[] = {
+        {"difference", signal(0, 0) + " - " + signal(1, 0)},
+        {"stateful", "avg(" + signal(0, 0) + ", 16) + deriv(" + signal(1, 0) + " / 3.6) + integ(" + signal(0, 1) + ")"},
+    };
+    for (const auto& [name, expression] : channels) {
+        suite.run(std::string("math/add/") + name, [&, expression = expression](uint64_t iterations) {
+            CAN::MathChannel channel("bench", expression, &traffic.database);
+            size_t batch = CAN::MessageBuffer::SEGMENT_FRAMES;
+            for (uint64_t i = 0; i < iterations; i += batch) {
+                size_t start = static_cast<size_t>(i % traffic.frames.size());
+                size_t count = std::min<size_t>({batch, traffic.frames.size() - start, static_cast<size_t>(iterations - i)});
+                channel.add(traffic.frames.data() + start, count, i);
+                channel.trim(i);
+            }
+            Bench::doNotOptimize(channel.size());
+            return iterations;
+        });
+    }
+}
+
+static void benchBuffer(Bench::Suite& suite) {
+    CAN::SyntheticOptions options;
+    options.messages = 200;
+    Traffic traffic(options, 1 << 16);
+
+    // Steady state: a full buffer drops its oldest segment every SEGMENT_FRAMES adds
+    suite.run("buffer/add_evict/16MB", [&](uint64_t iterations) {
+        CAN::MessageBuffer buffer(16 << 20, &traffic.store);
+        for (uint64_t i = 0; i < iterations; ++i) buffer.addMessage(traffic.frames[i % traffic.frames.size()]);
+        return iterations;
+    });
+
+    // Same traffic in batches of a segment, row bookkeeping is done once per batch
+    suite.run("buffer/add_batch/16MB", [&](uint64_t iterations) {
+        CAN::MessageBuffer buffer(16 << 20, &traffic.store);
+        size_t batch = CAN::MessageBuffer::SEGMENT_FRAMES;
+        for (uint64_t i = 0; i < iterations; i += batch) {
+            size_t start = static_cast<size_t>(i % traffic.frames.size());
+            size_t count = std::min<size_t>({batch, traffic.frames.size() - start, static_cast<size_t>(iterations - i)});
+            buffer.addMessages(traffic.frames.data() + start, count);
+        }
+        return iterations;
+    });
+
+    // Without a database only the row columns are written, the part batching amortizes
+    suite.run("buffer/add_rows/single", [&](uint64_t iterations) {
+        CAN::MessageBuffer buffer(16 << 20);
+        for (uint64_t i = 0; i < iterations; ++i) buffer.addMessage(traffic.frames[i % traffic.frames.size()]);
+        return iterations;
+    });
+    suite.run("buffer/add_rows/batch", [&](uint64_t iterations) {
+        CAN::MessageBuffer buffer(16 << 20);
+        size_t batch = CAN::MessageBuffer::SEGMENT_FRAMES;
+        for (uint64_t i = 0; i < iterations; i += batch) {
+            size_t start = static_cast<size_t>(i % traffic.frames.size());
+            size_t count = std::min<size_t>({batch, traffic.frames.size() - start, static_cast<size_t>(iterations - i)});
+            buffer.addMessages(traffic.frames.data() + start, count);
+        }
+        return iterations;
+    });
+
+    // Every segment past the budget is compressed and written out
+    suite.run("buffer/add_spill/16MB", [&](uint64_t iterations) {
+        CAN::MessageBuffer buffer(16 << 20, &traffic.store);
+        buffer.setSpill("bench_spill", uint64_t(1) << 40);
+        for (uint64_t i = 0; i < iterations; ++i) buffer.addMessage(traffic.frames[i % traffic.frames.size()]);
+        return iterations;
+    });
+
+    // Batches of a segment from several FD channels, decode split by id across threads
+    CAN::SyntheticOptions fd;
+    fd.messages = 200;
+    fd.signalsPerMessage = 32;
+    fd.fdRatio = 1.0;
+    Traffic fdTraffic(fd, 1 << 16);
+    for (size_t threads : {1, 2, 4, 8}) {
+        suite.run("buffer/add_batch/fd_32sig/threads:" + std::to_string(threads), [&](uint64_t iterations) {
+            CAN::MessageBuffer buffer(64 << 20, &fdTraffic.store);
+            buffer.setDecodeThreads(threads);
+            size_t batch = CAN::MessageBuffer::SEGMENT_FRAMES;
+            for (uint64_t i = 0; i < iterations; i += batch) {
+                size_t start = static_cast<size_t>(i % fdTraffic.frames.size());
+                size_t count = std::min<size_t>({batch, fdTraffic.frames.size() - start, static_cast<size_t>(iterations - i)});
+                buffer.addMessages(fdTraffic.frames.data() + start, count);
+            }
+            return iterations;
+        });
+    }
+
+    {
+        // Reads hopping between segments miss the cache and decode a segment each
+        CAN::MessageBuffer spilled(4 << 20, &traffic.store);
+        spilled.setSpill("bench_spill", uint64_t(1) << 40);
+        for (int i = 0; i < 8; ++i) {
+            for (const CAN::Frame& frame : traffic.frames) spilled.addMessage(frame);
+        }
+        bool ran = suite.run("buffer/spill_read/sequential", [&](uint64_t iterations) {
+            uint64_t total = 0;
+            for (uint64_t i = 0; i < iterations; ++i) total += spilled.frame(i % spilled.getSpilledFrames()).id;
+            Bench::doNotOptimize(total);
+            return iterations;
+        });
+        if (ran) suite.counter("buffer/spill_bytes_per_frame", static_cast<double>(spilled.getSpilledBytes()) / spilled.getSpilledFrames());
+        suite.run("buffer/spill_read/segment_miss", [&](uint64_t iterations) {
+            uint64_t total = 0;
+            size_t segments = spilled.getSpilledFrames() / CAN::MessageBuffer::SEGMENT_FRAMES;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                total += spilled.frame((i * 7919 % segments) * CAN::MessageBuffer::SEGMENT_FRAMES).id;
+            }
+            Bench::doNotOptimize(total);
+            return iterations;
+        });
+    }
+
+    CAN::MessageBuffer buffer(size_t(1) << 30, &traffic.store);
+    for (int i = 0; i < 4; ++i) {
+        for (const CAN::Frame& frame : traffic.frames) buffer.addMessage(frame);
+    }
+
+    const std::string signal = traffic.database.begin()->second.signals[0].name;
+    bool ran = suite.run("buffer/series/200ids", [&](uint64_t iterations) {
+        size_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) total += buffer.series(0x100 + i % 200, signal).size();
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+    if (ran) suite.counter("buffer/bytes_per_frame", static_cast<double>(buffer.memoryUsage().total()) / buffer.size());
+
+    // A paused view cut in the middle of the open segment
+    uint64_t paused = buffer.getSequence() - CAN::MessageBuffer::SEGMENT_FRAMES / 2;
+    suite.run("buffer/series/200ids_paused", [&](uint64_t iterations) {
+        size_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) total += buffer.series(0x100 + i % 200, signal, paused).size();
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+
+    // 100 ms windows at random positions, as a zoomed graph asks for them
+    uint64_t first = buffer.frame(0).timestamp, last = buffer.frame(buffer.size() - 1).timestamp;
+    suite.run("buffer/range/100ms", [&](uint64_t iterations) {
+        size_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            uint64_t t0 = first + (i * 2654435761u) % (last - first);
+            total += buffer.range(t0, t0 + 100000000).size();
+        }
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+
+    CAN::MessageBuffer::Series series = buffer.series(0x100, signal);
+    suite.run("buffer/series_range/100ms", [&](uint64_t iterations) {
+        size_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            uint64_t t0 = first + (i * 2654435761u) % (last - first);
+            total += series.range(t0, t0 + 100000000).size();
+        }
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+
+    suite.run("buffer/series_read", [&](uint64_t iterations) {
+        double total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) total += series.value(i % series.size());
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+}
+
+// One signal column as the buffer holds it
+struct SignalColumn {
+    const char* name;
+    std::vector<double> values;
+    double scale = 1.0;
+    double offset = 0.0;
+};
+
+static std::vector<SignalColumn> signalColumns(size_t count) {
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<SignalColumn> columns;
+
+    // Decoded values of one generated message: slow sines of scaled raw integers
+    CAN::SyntheticOptions options;
+    options.messages = 1;
+    CAN::Database database = CAN::syntheticDatabase(options);
+    const CAN::MessageDescription& description = database.begin()->second;
+    const CAN::SignalDescription& sigDes = description.signals[0];
+    CAN::SyntheticGenerator generator(database);
+    SignalColumn synthetic{"synthetic", {}, sigDes.scale, sigDes.offset};
+    std::vector<double> values(description.signals.size());
+    for (size_t i = 0; i < count; ++i) {
+        CAN::Frame frame = generator.next();
+        CAN::decodeMessage(description, frame.data, frame.sizeData, values.data());
+        synthetic.values.push_back(values[0]);
+    }
+    columns.push_back(synthetic);
+
+    // Shapes seen on vehicle buses: states that change every few seconds, alive counters, quantized
+    // sensors with noise, rarely set flags, and IEEE floats carrying full precision noise
+    SignalColumn state{"state", {}}, counter{"counter", {}}, sensor{"sensor", {}, 0.1f, -40.0f}, flag{"flag", {}}, real{"float", {}};
+    int current = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (random() % 500 == 0) current = static_cast<int>(random() % 6);
+        state.values.push_back(current);
+        counter.values.push_back(static_cast<double>(i % 16));
+        double raw = std::round(500 + 200 * std::sin(i * 0.001) + noise(random));
+        sensor.values.push_back(raw * sensor.scale + sensor.offset);
+        flag.values.push_back(random() % 1000 == 0 ? 1.0 : 0.0);
+        real.values.push_back(static_cast<float>(20 + std::sin(i * 0.01) + 0.01 * noise(random)));
+    }
+    columns.insert(columns.end(), {state, counter, sensor, flag, real});
+    return columns;
+}
+
+static void benchCodec(Bench::Suite& suite) {
+    const size_t count = 1 << 16;
+    for (const SignalColumn& signal : signalColumns(count)) {
+        std::string name = signal.name;
+        bool ran = suite.run("codec/column_compress/" + name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                Codec::Column column(signal.values.data(), count, signal.scale, signal.offset);
+                Bench::doNotOptimize(column.size());
+            }
+            return iterations * count;
+        });
+
+        Codec::Column column(signal.values.data(), count, signal.scale, signal.offset);
+        if (ran) suite.counter("codec/ratio/" + name, static_cast<double>(count * sizeof(double)) / column.bytes());
+
+        std::vector<double> block(Codec::Column::BLOCK);
+        size_t blocks = (count + Codec::Column::BLOCK - 1) / Codec::Column::BLOCK;
+        suite.run("codec/column_decompress/" + name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (size_t b = 0; b < blocks; ++b) column.decode(b, block.data());
+            }
+            Bench::doNotOptimize(block[0]);
+            return iterations * count;
+        });
+    }
+
+    // 10 ms cycle with a few us of jitter, as stamped by a driver
+    std::mt19937 random(1);
+    std::vector<uint64_t> timestamps(count);
+    for (size_t i = 0; i < count; ++i) timestamps[i] = i * 10000000 + random() % 20000;
+    std::vector<uint8_t> encoded;
+    bool ran = suite.run("codec/timestamps_compress/10ms_jitter", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            encoded.clear();
+            Codec::Writer(encoded).putTimestamps(timestamps.data(), count);
+        }
+        return iterations * count;
+    });
+    if (ran) suite.counter("codec/ratio/timestamps", static_cast<double>(count * sizeof(uint64_t)) / encoded.size());
+
+    encoded.clear();
+    Codec::Writer(encoded).putTimestamps(timestamps.data(), count);
+    std::vector<uint64_t> decoded(count);
+    suite.run("codec/timestamps_decompress/10ms_jitter", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) Codec::Reader(encoded.data(), encoded.size()).getTimestamps(decoded.data(), count);
+        Bench::doNotOptimize(decoded[0]);
+        return iterations * count;
+    });
+}
+
+static void benchClock(Bench::Suite& suite) {
+    // A wrapping 32 bit us counter on four channels, 50 ppm fast, with up to 200 us receive latency
+    std::mt19937 random(6);
+    std::vector<uint64_t> raw(65536), host(65536);
+    for (size_t i = 0; i < raw.size(); ++i) {
+        uint64_t device = 4294000000ULL + i * 250;
+        raw[i] = device & 0xFFFFFFFF;
+        host[i] = static_cast<uint64_t>(device * 1000 / 1.00005) + 1000000000 + random() % 200000;
+    }
+
+    CAN::TimestampAligner aligner;
+    suite.run("clock/align/4ch", [&](uint64_t iterations) {
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            size_t index = i % raw.size();
+            if (index == 0) aligner.reset();
+            total += aligner.align(index & 3, raw[index], host[index]);
+        }
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+}
+
+static void benchDatabase(Bench::Suite& suite) {
+    CAN::SyntheticOptions options;
+    options.messages = 200;
+    CAN::DatabaseStore store(CAN::syntheticDatabase(options));
+
+    // What a decoder pays per frame when nothing was published
+    CAN::DatabaseReader reader(&store);
+    suite.run("database/reader_get", [&](uint64_t iterations) {
+        size_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) total += reader.get()->size();
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+
+    suite.run("database/snapshot", [&](uint64_t iterations) {
+        size_t total = 0;
+        for (uint64_t i = 0; i < iterations; ++i) total += store.snapshot()->size();
+        Bench::doNotOptimize(total);
+        return iterations;
+    });
+
+    suite.run("database/update/200msg", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            store.update([i](CAN::Database& database) { database.begin()->second.plot = i & 1; });
+        }
+        return iterations;
+    });
+}
+
+static void benchSpectrum(Bench::Suite& suite) {
+    // Items are samples, a 1 kHz signal with 10 % timestamp jitter
+    for (size_t size : {size_t(4096), size_t(1) << 20}) {
+        std::vector<uint64_t> times(size);
+        std::vector<double> values(size);
+        std::mt19937 random(1);
+        std::uniform_int_distribution<uint64_t> jitter(0, 100000);
+        for (size_t i = 0; i < size; ++i) {
+            times[i] = i * 1000000 + jitter(random);
+            values[i] = std::sin(i * 0.01) + 0.1 * std::sin(i * 1.3);
+        }
+
+        std::string name = size > 4096 ? "1M" : "4096";
+        std::vector<double> uniform(size);
+        suite.run("spectrum/resample/" + name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) CAN::resample(times.data(), values.data(), size, times.front(), times.back(), uniform.data(), size);
+            Bench::doNotOptimize(uniform[size / 2]);
+            return iterations * size;
+        });
+
+        CAN::FFT fft(size);
+        std::vector<double> amplitudes(fft.bins());
+        suite.run("spectrum/fft/" + name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) fft.amplitudes(uniform.data(), amplitudes.data());
+            Bench::doNotOptimize(amplitudes[1]);
+            return iterations * size;
+        });
+    }
+}
+
+static void benchDBC(Bench::Suite& suite) {
+    CAN::SyntheticOptions options;
+    options.messages = 2000;
+    options.signalsPerMessage = 16;
+    const std::string filename = "canvis_bench_synthetic.dbc";
+    CAN::writeDBC(filename, CAN::syntheticDatabase(options));
+
+    suite.run("dbc/parse/2000msgs_16sig", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            CAN::Database database;
+            CAN::parseDBC(filename, database);
+            Bench::doNotOptimize(database.size());
+        }
+        return iterations * options.messages;
+    });
+
+    std::remove(filename.c_str());
+}
+
+static void benchIngest(Bench::Suite& suite) {
+    // Generator to buffer, items are frames
+    for (double fdRatio : {0.0, 0.25}) {
+        CAN::SyntheticOptions options;
+        options.messages = 100;
+        options.fdRatio = fdRatio;
+        Traffic traffic(options, 100000);
+
+        std::string name = fdRatio > 0 ? "ingest/mixed_fd25" : "ingest/classic";
+        suite.run(name, [&](uint64_t iterations) {
+            CAN::MessageBuffer buffer(size_t(256) << 20, &traffic.store);
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (const CAN::Frame& frame : traffic.frames) buffer.addMessage(frame);
+            }
+            return iterations * traffic.frames.size();
+        });
+    }
+
+    CAN::SyntheticOptions options;
+    options.messages = 100;
+    options.fdRatio = 0.25;
+    Traffic traffic(options, 100000);
+    suite.run("ingest/statistics/mixed_fd25", [&](uint64_t iterations) {
+        CAN::BusStatistics statistics(&traffic.store);
+        for (uint64_t i = 0; i < iterations; ++i) statistics.add(traffic.frames.data(), traffic.frames.size());
+        Bench::doNotOptimize(statistics.getChannel().frames);
+        return iterations * traffic.frames.size();
+    });
+
+    // Ten of the hundred messages plotted, items are frames
+    CAN::Database plotted = traffic.database;
+    for (auto it = plotted.begin(); it != std::next(plotted.begin(), 10); ++it) it->second.plot = true;
+    CAN::DatabaseStore plottedStore(plotted);
+    suite.run("ingest/signal_statistics/10_plotted", [&](uint64_t iterations) {
+        CAN::SignalStatistics statistics(&plottedStore);
+        for (uint64_t i = 0; i < iterations; ++i) statistics.add(traffic.frames.data(), traffic.frames.size());
+        Bench::doNotOptimize(statistics.get(plotted.begin()->second.id, 0));
+        return iterations * traffic.frames.size();
+    });
+
+    suite.run("ingest/running_statistics/add", [](uint64_t iterations) {
+        CAN::RunningStatistics statistics;
+        for (uint64_t i = 0; i < iterations; ++i) statistics.add(std::sin(static_cast<double>(i)));
+        Bench::doNotOptimize(statistics.getQuantile(1));
+        return iterations;
+    });
+
+    suite.run("ingest/generator", [](uint64_t iterations) {
+        CAN::SyntheticOptions options;
+        CAN::SyntheticGenerator generator(CAN::syntheticDatabase(options));
+        for (uint64_t i = 0; i < iterations; ++i) Bench::doNotOptimize(generator.next().id);
+        return iterations;
+    });
+}
+
+int main(int argc, char** argv) {
+    Bench::Suite suite(argc, argv);
+
+    benchMessage(suite);
+    benchFilter(suite);
+    benchMathChannel(suite);
+    benchBuffer(suite);
+    benchCodec(suite);
+    benchClock(suite);
+    benchDatabase(suite);
+    benchSpectrum(suite);
+    benchDBC(suite);
+    benchIngest(suite);
+
+    return suite.finish();
+}
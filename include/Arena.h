@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+namespace CAN {
+    class Arena;
+    template <typename T>
+    class ArenaAllocator;
+}
+
+// Bump allocator over blocks of BLOCK bytes, larger requests get a block of their own. Nothing is freed
+// on its own, release() gives back every block at once. Thread safe, meant for infrequent allocations
+// such as the growth of many vectors with the same lifetime.
+class CAN::Arena {
+public:
+    static constexpr size_t BLOCK = 256 * 1024;
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* position = nullptr;
+    size_t remaining = 0;
+    size_t reserved = 0;
+    std::mutex mutex;
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+    void release();
+    // Bytes of the blocks held
+    size_t bytes() const { return reserved; }
+};
+
+// Standard allocator on an arena, deallocate() does nothing
+template <typename T>
+class CAN::ArenaAllocator {
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    Arena* arena;
+
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
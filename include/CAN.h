@@ -12,24 +12,68 @@
 #include <map>
 #include <variant>
 
-#include "implot.h"
-
-#define BIG_ENDIAN 0
-#define LITTLE_ENDIAN 1
+#define SIGNAL_BIG_ENDIAN 0
+#define SIGNAL_LITTLE_ENDIAN 1
 #define UNSIGNED 0
 #define SIGNED 1
+#define SIG_INTEGER 0
+#define SIG_FLOAT 1
+#define SIG_DOUBLE 2
+#define MUX_NONE -1
+
+// Message flags, the low bits match CANAL's id flags
+#define MSG_FLAG_EXTENDED 0x00000001
+#define MSG_FLAG_RTR 0x00000002
+#define MSG_FLAG_FD 0x00000100
+#define MSG_FLAG_BRS 0x00000200
+#define MSG_FLAG_ESI 0x00000400
+#define MSG_FLAG_TAGGED 0x40000000 // Set on receive by a tagging filter
+#define MSG_FLAG_ERROR 0x80000000
+
+#define CLASSIC_DATA_LENGTH 8
+#define MAX_DATA_LENGTH 64
 
 namespace CAN {
+    struct SignalLayout;
     struct SignalDescription;
     struct MessageDescription;
 
-    using Signal = std::variant<bool, int, unsigned int, double>;
+    using Signal = std::variant<bool, int64_t, uint64_t, double>;
+    using Database = std::map<int, MessageDescription>;
+    struct Frame;
     struct Message;
-    class MessageBuffer;
 
-    void parseDBC(const std::string& filename, std::map<int, CAN::MessageDescription>& dbc);
+    void parseDBC(const std::string& filename, Database& dbc);
+    void writeDBC(const std::string& filename, const Database& dbc);
+
+    // Physical value of one signal in a payload, ignores multiplexing, see Message::decode()
+    Signal decodeSignal(const SignalDescription& signal, const uint8_t* data, size_t size);
+    // Raw bit pattern of one signal, bits past the end of the payload read as zero
+    uint64_t extractRaw(const uint8_t* data, size_t size, const SignalDescription& signal);
+    // Packs one physical value into its bits of the payload, the other bits are kept
+    void insertSignal(uint8_t* data, size_t size, const SignalDescription& signal, double value);
+    // Physical values of all signals of the description, NaN for multiplexed signals that are not present
+    void decodeMessage(const MessageDescription& description, const uint8_t* data, size_t size, double* values);
+
+    // CAN FD payloads only come in 0-8, 12, 16, 20, 24, 32, 48 and 64 bytes
+    size_t fdLength(size_t length);
+
+    // Bits the frame occupies on the bus including stuff bits and interframe space. Exact for classic
+    // frames, the dynamic stuffing of the FD CRC field is estimated. dataBits is the part sent at the
+    // data bitrate when BRS is set.
+    void frameBits(const Frame& frame, unsigned& nominalBits, unsigned& dataBits);
+    // Seconds the frame occupies the bus, bitrates in bit/s
+    double frameTime(const Frame& frame, unsigned long bitrate, unsigned long dataBitrate);
 }
 
+// Precomputed extraction of a signal from an 8 byte load window, see SignalDescription::compile()
+struct CAN::SignalLayout {
+    uint16_t byteOffset = 0;    // First byte of the load window
+    uint8_t shift = 0;          // Right shift applied to the loaded window
+    uint64_t mask = 0;          // Mask of length bits
+    bool window = false;        // False if the signal spans more than 8 bytes and needs the bitwise path
+};
+
 struct CAN::SignalDescription {
     std::string name;
     int startBit;
@@ -41,6 +85,14 @@ struct CAN::SignalDescription {
     float min;
     float max;
     std::string unit;
+    int valueType = SIG_INTEGER; // SIG_VALTYPE_, IEEE float32/float64 signals
+    bool multiplexer = false;    // Multiplexer switch ("M")
+    int multiplexValue = MUX_NONE; // Only present when the switch has this value ("m<n>")
+
+    SignalLayout layout;
+
+    // Must be called after changing startBit, length, endianess or valueType
+    void compile();
 };
 
 struct CAN::MessageDescription {
@@ -49,10 +101,27 @@ struct CAN::MessageDescription {
     size_t length;
     std::string sender;
     std::vector<SignalDescription> signals;
+    unsigned long cycleTime = 0; // ms, GenMsgCycleTime attribute
 
     bool plot = false;
 };
 
+// Device level frame, classic or FD
+struct CAN::Frame {
+    unsigned long flags = 0;
+    unsigned long obid = 0;
+    unsigned long id = 0;
+    unsigned char sizeData = 0;
+    uint8_t data[MAX_DATA_LENGTH] = {};
+    uint64_t timestamp = 0; // ns, on the host steady clock for live devices
+
+    Frame() = default;
+    // Keeps the raw driver timestamp, devices align it to the host clock
+    Frame(const CANALMSG& canalMessage);
+
+    bool isFD() const { return flags & MSG_FLAG_FD; }
+};
+
 struct CAN::Message {
     unsigned long flags;
     unsigned long obid;
@@ -60,13 +129,17 @@ struct CAN::Message {
     unsigned char sizeData;
     std::vector<uint8_t> rawData;
     std::unordered_map<std::string, Signal> decodedData;
-    unsigned long timestamp;
+    uint64_t timestamp; // ns
 
-    Message(const CANALMSG& canalMessage);
+    // Decodes the signals of description if one is given
+    Message(const Frame& frame, const MessageDescription* description = nullptr);
+    Message(const CANALMSG& canalMessage, const MessageDescription* description = nullptr);
 
     
-    void decode();
-    void encode(int* buffer);
+    void decode(const MessageDescription& description);
+
+    // Packs one physical value per signal of the description into the frame, inverse of decode()
+    static void encode(const MessageDescription& description, const double* values, Frame& frame);
     Signal getSignal(const std::string& name) const;
 
     template <typename T>
@@ -91,26 +164,3 @@ struct CAN::Message {
 private:
     Signal extractSignal(const SignalDescription& signalDescription);
 };
-
-class CAN::MessageBuffer {
-private:
-    std::deque<Message> messages;
-    std::unordered_map<int, std::deque<Message*>> messageMap;
-    size_t maxSize;
-
-    void pop_front();
-
-public:
-    explicit MessageBuffer(size_t maxSize);
-
-    void addMessage(const Message& message);
-    void setMaxSize(size_t maxSize);
-
-    const std::deque<Message*>& ofID(int id) const;
-    // ImPlotPoint getter<int>(int idx, void* label);
-
-    std::deque<Message>::iterator begin();
-    std::deque<Message>::iterator end();
-    std::deque<Message>::const_iterator begin() const;
-    std::deque<Message>::const_iterator end() const;
-};
\ No newline at end of file
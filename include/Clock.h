@@ -0,0 +1,56 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+namespace CAN {
+    class TimestampAligner;
+
+    // Nanoseconds of the host steady clock, the timeline of every frame timestamp
+    inline uint64_t hostTime() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+// Maps raw device timestamps onto the host steady clock in ns, per channel. Raw counters are unwrapped
+// at rawBits. Receive latency only ever adds to host - device, so the offset follows the lower envelope
+// of it: the minimum of each WINDOW long window, with a line fitted through the last WINDOWS minima to
+// correct the drift of the device oscillator. Aligned timestamps never decrease within a channel and are
+// never later than the host time they were received at. Not thread safe.
+class CAN::TimestampAligner {
+public:
+    static constexpr uint64_t WINDOW = 1000000000; // ns
+    static constexpr size_t WINDOWS = 16;
+    static constexpr double MAX_DRIFT = 1e-3;      // Crystal tolerances stay well below 1000 ppm
+
+private:
+    struct Channel {
+        uint64_t lastRaw = 0;
+        uint64_t wraps = 0;   // Raw ticks added by unwrapping
+        uint64_t last = 0;    // Last aligned timestamp
+
+        std::deque<std::pair<double, double>> minima; // Device time and host - device of closed windows
+        double windowStart = 0;
+        double windowMinimum = 0;
+        double windowDevice = 0;
+
+        // host - device = offset + drift * (device - reference)
+        double offset = 0;
+        double drift = 0;
+        double reference = 0;
+    };
+
+    double nsPerTick;
+    int rawBits;
+    std::unordered_map<unsigned long, Channel> channels;
+
+    static void fit(Channel& channel);
+
+public:
+    explicit TimestampAligner(double nsPerTick = 1000.0, int rawBits = 32);
+
+    uint64_t align(unsigned long channel, uint64_t raw, uint64_t host);
+    void reset() { channels.clear(); }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Encoding of message buffer segments: little endian integers, varints, zero run packing, delta of
+// delta timestamps and block compressed columns of doubles
+namespace Codec {
+    class Writer;
+    class Reader;
+    class Column;
+
+    inline uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+    inline int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+}
+
+class Codec::Writer {
+private:
+    std::vector<uint8_t>& out;
+
+public:
+    explicit Writer(std::vector<uint8_t>& out) : out(out) {}
+
+    void put(uint64_t value, int bytes);
+    void putVarint(uint64_t value);
+    void putBytes(const uint8_t* data, size_t size);
+    void putString(const std::string& value);
+    // Runs of zero bytes shrink to one control byte, other bytes are copied with one control byte per 128
+    void putPacked(const uint8_t* data, size_t size);
+    // Delta of delta bit stream, one bit per timestamp when the interval does not change
+    void putTimestamps(const uint64_t* values, size_t count);
+};
+
+// Reads past the end throw std::runtime_error
+class Codec::Reader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+
+    void need(size_t bytes) const;
+
+public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint64_t get(int bytes);
+    uint64_t getVarint();
+    void getBytes(uint8_t* out, size_t count);
+    std::string getString();
+    void getPacked(uint8_t* out, size_t count);
+    void getTimestamps(uint64_t* out, size_t count);
+    size_t offset() const { return position; }
+    bool atEnd() const { return position == size; }
+};
+
+// Doubles compressed in independent blocks of BLOCK values so a random read decodes one block. A block
+// of values that are raw integers under the column's scale and offset, NaNs allowed, is bit packed as
+// raw offsets from its minimum. Any other block is XORed value to value and stored with the leading and
+// trailing zero windows of Gorilla (Pelkonen et al., VLDB 2015). Both are lossless.
+class Codec::Column {
+public:
+    static constexpr size_t BLOCK = 128;
+
+private:
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> blocks; // Start of each block in data
+    size_t count = 0;
+    double scale = 1.0;
+    double offset = 0.0;
+
+public:
+    Column() = default;
+    // Scale and offset of the signal, raw integers bit pack far better than their scaled values
+    Column(const double* values, size_t count, double scale = 1.0, double offset = 0.0);
+
+    size_t size() const { return count; }
+    size_t bytes() const { return data.capacity() + blocks.capacity() * sizeof(uint32_t); }
+
+    // Writes the values of a block to out, BLOCK of them except in the last block, returns how many
+    size_t decode(size_t block, double* out) const;
+    // Decodes the whole block, sequential readers should keep a block from decode instead
+    double at(size_t index) const;
+
+    void write(Writer& writer) const;
+    static Column read(Reader& reader);
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <functional>
+#include "CAN.h"
+
+namespace CAN {
+    class DatabaseStore;
+    class DatabaseReader;
+
+    // One published version of the database, never changed and kept alive by its holders
+    using DatabaseSnapshot = std::shared_ptr<const Database>;
+}
+
+// The message database published as immutable snapshots, read-copy-update style. Readers take the
+// current snapshot without waiting for writers and it stays valid for as long as they hold it. Edits copy
+// the current database, change the copy and swap it in, so pointers into a snapshot never dangle.
+// Writers are serialized with each other only.
+class CAN::DatabaseStore {
+private:
+    DatabaseSnapshot current;
+    std::atomic<uint64_t> version{1};
+    std::mutex writeMutex;
+
+public:
+    explicit DatabaseStore(Database database = Database());
+
+    DatabaseStore(const DatabaseStore&) = delete;
+    DatabaseStore& operator=(const DatabaseStore&) = delete;
+
+    DatabaseSnapshot snapshot() const { return std::atomic_load_explicit(&current, std::memory_order_acquire); }
+    // Increases with every publish, one atomic load
+    uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
+
+    void publish(Database database);
+    // Applies edit to a copy of the current database and publishes the copy
+    void update(const std::function<void(Database&)>& edit);
+};
+
+// Follows a store from one thread. get() only takes a new snapshot when the version changed, so a hot path
+// pays one atomic load per call. The returned database stays valid until the next get() on this reader.
+class CAN::DatabaseReader {
+private:
+    const DatabaseStore* store;
+    DatabaseSnapshot snapshot;
+    uint64_t version = 0;
+
+public:
+    explicit DatabaseReader(const DatabaseStore* store = nullptr) : store(store) {}
+
+    const Database* get() {
+        if (!store) return nullptr;
+        uint64_t latest = store->getVersion();
+        if (latest != version) {
+            // The snapshot is published before the version, it is at least as new as latest
+            snapshot = store->snapshot();
+            version = latest;
+        }
+        return snapshot.get();
+    }
+    // Version of the snapshot returned by the last get()
+    uint64_t getVersion() const { return version; }
+};
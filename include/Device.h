@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CAN.h"
+#include "Filter.h"
+#include "Clock.h"
+
+namespace CAN {
+    class Device;
+#ifdef CANVIS_WITH_CANAL
+    class CanalDevice;
+#endif
+#ifdef __linux__
+    class SocketCANDevice;
+#endif
+}
+
+// Backend independent access to a CAN channel, all calls return CANAL_ERROR_* codes
+class CAN::Device {
+public:
+    virtual ~Device() = default;
+
+    // Non-blocking, false if no frame is available
+    virtual bool receive(Frame& frame) = 0;
+    virtual bool receive(Frame& frame, unsigned long timeout) = 0;
+    // Waits up to timeout ms for the first frame, then takes what is already available, returns the count
+    virtual size_t receiveBatch(Frame* frames, size_t count, unsigned long timeout);
+
+    virtual int send(const Frame& frame) = 0;
+    virtual int send(const Frame& frame, unsigned long timeout) = 0;
+    // Sends frames in order until the first failure, returns the number sent and the failure in error
+    virtual size_t sendBatch(const Frame* frames, size_t count, int& error);
+
+    virtual bool supportsFD() const = 0;
+
+    // Driver side counters, CANAL_ERROR_NOT_SUPPORTED if the backend has none
+    virtual int getStatistics(CANALSTATISTICS&) { return CANAL_ERROR_NOT_SUPPORTED; }
+    // Accept only ids passing one of the filters, all ids if empty. Backends may accept more.
+    virtual int setFilters(const std::vector<IDFilter>&) { return CANAL_ERROR_NOT_SUPPORTED; }
+};
+
+#ifdef CANVIS_WITH_CANAL
+// USB2CAN through the CANAL driver, classic frames only. The driver stamps frames in us with a 32 bit
+// counter, they are unwrapped and aligned to the host clock.
+class CAN::CanalDevice : public CAN::Device {
+private:
+    long handle;
+    // The adapter has one timestamp counter, obid varies from frame to frame and does not name a clock
+    static constexpr unsigned long CLOCK = 0;
+    TimestampAligner aligner{1000.0, 32};
+
+    static CANALMSG toCanal(const Frame& frame);
+
+public:
+    CanalDevice(const std::string& config, unsigned long flags = 0);
+    ~CanalDevice() override;
+
+    CanalDevice(const CanalDevice&) = delete;
+    CanalDevice& operator=(const CanalDevice&) = delete;
+
+    bool receive(Frame& frame) override;
+    bool receive(Frame& frame, unsigned long timeout) override;
+
+    int send(const Frame& frame) override;
+    int send(const Frame& frame, unsigned long timeout) override;
+
+    bool supportsFD() const override { return false; }
+
+    int getStatistics(CANALSTATISTICS& statistics) override;
+    // The driver has a single code and mask, several filters are merged into one that accepts all of them
+    int setFilters(const std::vector<IDFilter>& filters) override;
+
+    long getHandle() const { return handle; }
+};
+#endif
+
+#ifdef __linux__
+// Raw SocketCAN socket with CAN FD frames enabled, frames are stamped with the host clock on receipt
+class CAN::SocketCANDevice : public CAN::Device {
+private:
+    int socketFD;
+
+public:
+    explicit SocketCANDevice(const std::string& interface);
+    ~SocketCANDevice() override;
+
+    SocketCANDevice(const SocketCANDevice&) = delete;
+    SocketCANDevice& operator=(const SocketCANDevice&) = delete;
+
+    bool receive(Frame& frame) override;
+    bool receive(Frame& frame, unsigned long timeout) override;
+    size_t receiveBatch(Frame* frames, size_t count, unsigned long timeout) override;
+
+    int send(const Frame& frame) override;
+    int send(const Frame& frame, unsigned long timeout) override;
+    size_t sendBatch(const Frame* frames, size_t count, int& error) override;
+
+    bool supportsFD() const override { return true; }
+
+    int setFilters(const std::vector<IDFilter>& filters) override;
+
+    int getSocket() const { return socketFD; }
+};
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "CAN.h"
+
+namespace CAN {
+    struct SignalBinding;
+    class ExpressionLexer;
+
+    // Numeric value of a decoded signal
+    double toDouble(const Signal& signal);
+    // Signals of the database named "Signal" or "Message.Signal", one per message that has it
+    std::vector<SignalBinding> bindSignal(const std::string& name, const Database& database);
+}
+
+// A database signal in the message with one id, as used by filter and math channel expressions
+struct CAN::SignalBinding {
+    unsigned long id;
+    SignalDescription signal;
+    bool multiplexed = false;
+    SignalDescription multiplexer;
+
+    // Physical value from the payload of a frame with this id, false if the multiplexer selects another signal
+    bool decode(const uint8_t* data, size_t size, double& value) const;
+};
+
+// Tokens shared by the expression parsers, which derive from it. Errors throw std::runtime_error naming
+// the kind of expression and the position.
+class CAN::ExpressionLexer {
+protected:
+    const std::string& text;
+    std::string kind;
+    size_t position = 0;
+
+    ExpressionLexer(const std::string& text, const std::string& kind) : text(text), kind(kind) {}
+
+    [[noreturn]] void fail(const std::string& message) const;
+    void skipSpace();
+    // Keywords must not run into an identifier
+    bool accept(const char* token);
+    void expect(const char* token);
+    // Letters, digits, '_' and '.', but not "..". Empty if there is no identifier at the position.
+    std::string identifier();
+    // Fails unless only space is left
+    void expectEnd();
+};
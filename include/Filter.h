@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "CAN.h"
+#include "Expression.h"
+
+namespace CAN {
+    struct IDFilter;
+    class Filter;
+}
+
+// Acceptance code and mask for driver side filtering, mask bits set to 1 must match
+struct CAN::IDFilter {
+    unsigned long id;
+    unsigned long mask;
+};
+
+// Frame filter compiled to a short branch program. Expressions combine predicates with &&, || and !:
+//
+//   id == 0x123, id in 0x100..0x1FF, id & 0x700 == 0x100, channel == 1, dlc > 8,
+//   data[2] == 0xFF, data[0] & 0x0F != 0, ext, rtr, fd, brs, esi, error,
+//   EngineSpeed > 3000, Engine.EngineSpeed in 800..900
+//
+// Comparisons are ==, !=, <, <=, > and >=. channel is the frame's obid. Signal predicates bind to the
+// database when the filter is compiled and are false for frames without the signal.
+class CAN::Filter {
+private:
+    enum Op : uint8_t { TEST, NOT, JUMP_FALSE, JUMP_TRUE };
+    enum Field : uint8_t { FIELD_ID, FIELD_DLC, FIELD_CHANNEL, FIELD_FLAGS, FIELD_DATA, FIELD_SIGNAL };
+    enum Compare : uint8_t { EQ, NE, LT, LE, GT, GE, RANGE };
+
+    struct Instruction {
+        Op op = TEST;
+        Field field = FIELD_ID;
+        Compare compare = EQ;
+        uint32_t index = 0;   // Data byte, signal predicate or jump target
+        uint64_t mask = 0;    // Applied before comparing when not 0
+        double low = 0;
+        double high = 0;      // Upper bound of RANGE, inclusive
+    };
+
+    struct Node;
+    class Parser;
+
+    std::string expression;
+    std::vector<Instruction> program;
+    std::vector<std::vector<SignalBinding>> signals; // Per signal predicate, one entry per message id
+    std::vector<IDFilter> idFilters;
+
+    void compile(const Node& node);
+    // Id filters implied by a subtree, nullopt if it can match any id
+    static std::optional<std::vector<IDFilter>> pushDown(const Node& node);
+    bool test(const Instruction& instruction, const Frame& frame) const;
+
+public:
+    // Accepts every frame
+    Filter() = default;
+    // Throws std::runtime_error on syntax errors and unknown signals
+    explicit Filter(const std::string& expression, const Database* database = nullptr);
+
+    bool matches(const Frame& frame) const;
+
+    bool empty() const { return program.empty(); }
+    const std::string& getExpression() const { return expression; }
+    // Accept a superset of the matching ids, empty if the expression has no id constraint that a driver
+    // can apply. Frames still have to go through matches().
+    const std::vector<IDFilter>& getIDFilters() const { return idFilters; }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include "CAN.h"
+
+// Binary capture log: a 16 byte file header ("CANVISLG", version, reserved) followed by records of
+// a 20 byte little endian header (timestamp u64, id u32, flags u32, channel u8, length u8, reserved u16)
+// and length payload bytes. Timestamps are in ns since version 2, in us before.
+#define LOG_MAGIC "CANVISLG"
+#define LOG_VERSION 2
+#define LOG_HEADER_SIZE 16
+#define LOG_RECORD_SIZE 20
+
+namespace CAN {
+    class LogWriter;
+    class LogReader;
+}
+
+// Buffered writer, starts a new file when it exceeds rotateSize bytes or rotateTime seconds (0 disables).
+// Throws std::runtime_error when a file cannot be opened or written, e.g. on a full disk.
+class CAN::LogWriter {
+private:
+    std::string basename;
+    uint64_t rotateSize;
+    unsigned long rotateTime;
+
+    std::FILE* file = nullptr;
+    std::string filename;
+    std::vector<uint8_t> buffer;
+    uint64_t fileBytes = 0;
+    uint64_t totalFrames = 0;
+    uint64_t totalBytes = 0;
+    unsigned fileIndex = 0;
+    std::chrono::steady_clock::time_point opened;
+
+    void open();
+    void close();
+    // False if the buffered records did not all reach the file
+    bool writeBuffer();
+
+public:
+    LogWriter(const std::string& basename, uint64_t rotateSize = 0, unsigned long rotateTime = 0);
+    ~LogWriter();
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    void write(const Frame& frame);
+    void write(const Frame* frames, size_t count);
+    void flush();
+
+    const std::string& currentFile() const { return filename; }
+    uint64_t framesWritten() const { return totalFrames; }
+    uint64_t bytesWritten() const { return totalBytes; }
+};
+
+class CAN::LogReader {
+private:
+    std::FILE* file;
+    unsigned version;
+
+public:
+    explicit LogReader(const std::string& filename);
+    ~LogReader();
+
+    LogReader(const LogReader&) = delete;
+    LogReader& operator=(const LogReader&) = delete;
+
+    // False at the end of the file
+    bool read(Frame& frame);
+};
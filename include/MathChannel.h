@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include "CAN.h"
+#include "Expression.h"
+
+namespace CAN {
+    class MathChannel;
+}
+
+// Signal derived from database signals, compiled to a stack program that runs over batches of samples:
+//
+//   WheelSpeedFL - WheelSpeedFR, Engine.EngineSpeed * 2 * 3.14159 / 60, VehicleSpeed / 3.6,
+//   avg(VehicleSpeed, 10), deriv(VehicleSpeed / 3.6), integ(Current) / 3600, abs(x), min(a, b), max(a, b)
+//
+// Operators are +, -, * and / with unary -. avg is the mean of the last n samples, deriv the change per
+// second and integ the trapezoidal integral over seconds. A sample is computed for every frame that
+// carries an input, the other inputs hold their last value; there are no samples until every input has
+// been received once. Inputs bind to the database when the channel is compiled. Not thread safe.
+class CAN::MathChannel {
+public:
+    // Half open range of sample indices
+    struct Span {
+        size_t begin = 0;
+        size_t end = 0;
+
+        size_t size() const { return end - begin; }
+    };
+
+private:
+    enum Op : uint8_t { INPUT, CONSTANT, ADD, SUB, MUL, DIV, NEG, ABS, MIN, MAX, AVG, DERIV, INTEG };
+
+    struct Instruction {
+        Op op;
+        uint32_t index = 0; // Input, or state of AVG, DERIV and INTEG
+        double value = 0;   // Constant, or window of AVG
+    };
+
+    // An input in one message, a signal name can match several
+    struct Input {
+        SignalBinding binding;
+        uint32_t slot; // Held value
+    };
+
+    // Running state of a stateful instruction, carried from batch to batch
+    struct State {
+        std::vector<double> window; // Ring of the last samples of AVG
+        size_t next = 0;
+        size_t count = 0;           // Samples in the ring, or slopes seen by DERIV
+        double sum = 0;
+        double last = 0;
+        double result = 0;
+        uint64_t time = 0;
+        bool started = false;
+    };
+
+    class Parser;
+
+    std::string name;
+    std::string expression;
+    std::vector<Instruction> program;
+    std::vector<Input> inputs;
+    std::vector<State> states;
+    size_t slots = 0;
+    size_t depth = 0; // Stack slots the program needs
+
+    std::vector<double> held;
+    std::vector<bool> seen;
+    size_t missing = 0; // Slots without a value yet
+
+    // Rows gathered from the current batch, one column per slot
+    std::vector<uint64_t> batchTimes;
+    std::vector<std::vector<double>> batchInputs;
+    std::vector<std::vector<double>> stack;
+
+    std::deque<uint64_t> times;
+    std::deque<uint64_t> sequences; // Buffer sequence number of the frame each sample came from
+    std::deque<double> values;
+    bool sorted = true;
+
+    static bool binary(Op op) { return (op >= ADD && op <= DIV) || op == MIN || op == MAX; }
+    void evaluate(size_t rows);
+
+public:
+    // Throws std::runtime_error on syntax errors and unknown signals
+    MathChannel(const std::string& name, const std::string& expression, const Database* database);
+
+    // Evaluates the frames of a batch in order, frames[0] has buffer sequence number sequence
+    void add(const Frame* frames, size_t count, uint64_t sequence);
+    // Drops the samples of frames before sequence, e.g. MessageBuffer::getMemorySequence() so the channel
+    // holds samples for the frames in memory
+    void trim(uint64_t sequence);
+    // Drops the samples and restarts avg, deriv and integ
+    void clear();
+
+    const std::string& getName() const { return name; }
+    const std::string& getExpression() const { return expression; }
+
+    size_t size() const { return values.size(); }
+    // Bytes held by the samples
+    size_t memory() const { return values.size() * (sizeof(uint64_t) * 2 + sizeof(double)); }
+    // Samples of the frames before sequence, see MessageBuffer::sizeAt
+    size_t sizeAt(uint64_t sequence) const;
+    uint64_t time(size_t index) const { return times[index]; }
+    double value(size_t index) const { return values[index]; }
+    // Samples with timestamps from t0 to t1, all of them once channels interleave out of timestamp order
+    Span range(uint64_t t0, uint64_t t1) const;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include "CAN.h"
+#include "Database.h"
+#include "SegmentStore.h"
+#include "Codec.h"
+#include "WorkerPool.h"
+#include "Arena.h"
+
+namespace CAN {
+    struct MemoryUsage;
+    class MessageBuffer;
+}
+
+// Bytes owned by a MessageBuffer, from container capacities. Allocator overhead is not included.
+struct CAN::MemoryUsage {
+    size_t frames = 0;  // Timestamp, id, flags, channel, length and offset columns
+    size_t payload = 0;
+    size_t columns = 0; // Decoded signal values
+    size_t index = 0;   // Per id row lists and their hash tables
+    size_t strings = 0; // Signal names of the decoded columns
+    size_t cache = 0;   // Spilled segments read back
+    size_t derived = 0; // Kept by others for the frames in memory, see MessageBuffer::setDerivedMemory()
+
+    size_t total() const { return frames + payload + columns + index + strings + cache + derived; }
+};
+
+// Received frames in columnar segments of SEGMENT_FRAMES rows, signals are decoded into one column per
+// signal and id on arrival. Once the memory use exceeds the budget the oldest segments are dropped, or
+// with spilling enabled compressed into a SegmentStore and read back through a small LRU cache on access.
+// Spilled segments are dropped once the store exceeds the disk budget. Indices run from 0 for the oldest
+// frame held, in memory or on disk. Series and indices stay valid until the next add.
+class CAN::MessageBuffer {
+public:
+    class Series;
+    static constexpr size_t SEGMENT_FRAMES = 4096;
+    static constexpr size_t CACHE_SEGMENTS = 8;
+    static constexpr size_t MIN_PARALLEL_FRAMES = 256; // Smaller chunks are decoded on the calling thread
+
+    // Half open range of indices
+    struct Span {
+        size_t begin = 0;
+        size_t end = 0;
+
+        size_t size() const { return end - begin; }
+        bool empty() const { return begin == end; }
+    };
+
+private:
+    struct Stream {
+        std::vector<uint32_t> rows;               // Rows of the segment with this id
+        std::vector<std::string> names;           // Signal of each column
+        std::vector<std::vector<double, ArenaAllocator<double>>> columns; // NaN where a multiplexed signal is absent, empty once sealed
+        std::vector<Codec::Column> packed;        // The columns of a sealed segment
+        const MessageDescription* layout = nullptr; // Description last matched to the columns by name
+        std::vector<uint32_t> layoutColumns;      // Column of each of its signals, empty once sealed
+
+        double at(size_t column, size_t row) const { return columns.empty() ? packed[column].at(row) : columns[column][row]; }
+    };
+
+    struct Segment {
+        std::vector<uint64_t> timestamps;
+        std::vector<uint32_t> ids;
+        std::vector<uint32_t> flags;
+        std::vector<uint8_t> channels;
+        std::vector<uint8_t> lengths;
+        std::vector<uint32_t> offsets;    // Start of the row's payload
+        std::vector<uint32_t> streamRows; // Position of the row in its stream
+        std::vector<uint8_t> payload;
+        std::unordered_map<uint32_t, Stream> streams;
+        uint64_t first = UINT64_MAX; // Smallest timestamp
+        uint64_t last = 0;           // Largest timestamp
+        bool sorted = true;          // Timestamps never decrease, false when channels interleave out of order
+        Arena arena;                 // Decoded columns until the segment is sealed, freed as a whole then
+
+        Segment();
+        size_t size() const { return timestamps.size(); }
+        // Compresses the columns, the database provides the scale and offset of each signal
+        // Streams are compressed on the workers of pool if one is given
+        void seal(const Database* database, WorkerPool* pool = nullptr);
+        static void sealStream(uint32_t id, Stream& stream, const Database* database);
+        void memory(MemoryUsage& usage) const;
+
+        // Row lists and offsets are not stored, decode rebuilds them
+        void encode(std::vector<uint8_t>& out) const;
+        static std::shared_ptr<Segment> decode(const std::vector<uint8_t>& in);
+    };
+
+    // A segment on disk, with the row count of each id kept so series can be built without reading it
+    struct Spilled {
+        SegmentStore::Location location;
+        std::vector<std::pair<uint32_t, uint32_t>> streams; // By id
+        uint64_t first;
+        uint64_t last;
+
+        size_t memory() const { return sizeof(Spilled) + streams.capacity() * sizeof(streams[0]); }
+    };
+
+    std::deque<Spilled> spilled;                   // Oldest first, all older than the segments in memory
+    std::deque<std::shared_ptr<Segment>> segments; // The last one takes new frames
+    uint64_t dropped = 0;                          // Segments dropped so far, numbers segments across drops
+    size_t budget;
+    DatabaseReader database;
+    uint64_t layoutVersion = 0; // Database version the stream layouts of the open segment point into
+    size_t sealedBytes = 0;
+    size_t spilledBytes = 0; // Memory of the spilled index
+    size_t derivedBytes = 0;
+    uint64_t evicted = 0;
+    uint64_t sequence = 0;   // Frames added since construction, clear() does not reset it
+    std::vector<double> values;
+
+    // Frame of a batch whose signals are still to be decoded
+    struct Job {
+        Stream* stream;
+        const MessageDescription* description;
+        uint32_t streamRow;
+    };
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<Job> jobs;
+    std::vector<std::vector<double>> scratch; // Decoded values, one per worker
+
+    std::unique_ptr<SegmentStore> store;
+    uint64_t diskBudget = 0;
+    std::string spillError;
+    std::vector<uint8_t> encoded;
+    mutable std::list<std::pair<uint64_t, std::shared_ptr<const Segment>>> cache; // Most recently used first
+
+    // Position counts from the oldest segment held
+    std::shared_ptr<const Segment> segment(size_t position) const;
+    void locate(size_t index, std::shared_ptr<const Segment>& segment, size_t& row) const;
+    void bounds(size_t position, uint64_t& first, uint64_t& last) const;
+    void spill(const Segment& segment);
+    void dropSpilled();
+    void enforceBudget();
+
+    // Seals a full last segment and starts a new one
+    Segment& openSegment(const Database* snapshot);
+    // Forgets the stream layouts of the open segment once the database changed, as their descriptions
+    // are freed with the old snapshot
+    void checkLayouts();
+    // Every column but the decoded signals
+    Stream& appendRow(Segment& segment, const Frame& frame);
+    // Same for a batch that fits the segment, leaves the decode of each frame in jobs
+    void appendRows(Segment& segment, const Frame* frames, size_t count, const Database* snapshot);
+    static const MessageDescription* describe(const Database* snapshot, uint32_t id);
+    static bool decodable(const Frame& frame) { return !(frame.flags & (MSG_FLAG_RTR | MSG_FLAG_ERROR)); }
+    static void decodeRow(Stream& stream, size_t streamRow, const MessageDescription* description, const Frame& frame,
+                          Arena& arena, std::vector<double>& values);
+
+public:
+    explicit MessageBuffer(size_t budget, const DatabaseStore* database = nullptr);
+
+    // Decodes the frame against the latest database snapshot
+    void addMessage(const Frame& frame);
+    // Same as adding each frame in turn, with the per row bookkeeping done once per batch. With decode
+    // threads the signals of a batch are decoded in parallel, split by id so the values of each id stay
+    // in frame order.
+    void addMessages(const Frame* frames, size_t count);
+    // 1 decodes on the calling thread, which always takes part in decoding
+    void setDecodeThreads(size_t threads);
+    size_t getDecodeThreads() const { return pool ? pool->size() : 1; }
+    void setBudget(size_t bytes);
+    size_t getBudget() const { return budget; }
+    // Memory of data derived from the frames in memory and dropped with them, e.g. math channel samples,
+    // counted against the budget. Until the next call it is assumed to shrink in proportion to the
+    // frames that leave memory.
+    void setDerivedMemory(size_t bytes) { derivedBytes = bytes; }
+    // Spills into directory instead of dropping, up to diskBudget bytes. An empty directory disables
+    // spilling and drops what was spilled, so does changing the directory. Throws std::runtime_error.
+    void setSpill(const std::string& directory, uint64_t diskBudget);
+    bool isSpilling() const { return store != nullptr; }
+    // Why spilling stopped by itself, e.g. on a full disk. The spilled frames are dropped then and the
+    // oldest segments are dropped from then on. Cleared by setSpill().
+    const std::string& getSpillError() const { return spillError; }
+    void clear();
+
+    size_t size() const;
+    // Sequence number the next frame gets. Frames are only appended, so the frames added before a sequence
+    // number are a fixed prefix of the buffer and a view can be frozen by keeping the number alone.
+    uint64_t getSequence() const { return sequence; }
+    // Frames held that were added before sequence, indices 0 to sizeAt(sequence) - 1. Frames dropped by
+    // the budget leave a frozen view too.
+    size_t sizeAt(uint64_t sequence) const;
+    // Sequence number of the oldest frame in memory, older frames are spilled or dropped
+    uint64_t getMemorySequence() const;
+    Frame frame(size_t index) const;
+    // Decoded value of a signal of the frame at index, NaN if it was not decoded
+    double value(size_t index, const std::string& signal) const;
+    // All values of one signal of one id, oldest first, from the frames added before sequence
+    Series series(unsigned long id, const std::string& signal, uint64_t sequence = UINT64_MAX) const;
+    // Frames with timestamps from t0 to t1. Segments are found by their timestamp bounds, frames in the
+    // two boundary segments by binary search. Frames outside the window can be included where channels
+    // interleave out of timestamp order, never excluded.
+    Span range(uint64_t t0, uint64_t t1) const;
+
+    MemoryUsage memoryUsage() const;
+    uint64_t getEvicted() const { return evicted; }
+    size_t getSpilledFrames() const { return spilled.size() * SEGMENT_FRAMES; }
+    uint64_t getSpilledBytes() const { return store ? store->bytes() : 0; }
+};
+
+class CAN::MessageBuffer::Series {
+private:
+    friend class MessageBuffer;
+
+    struct Part {
+        uint64_t segment; // Number of the segment, see MessageBuffer::dropped
+        size_t start;
+    };
+
+    const MessageBuffer* buffer = nullptr;
+    uint32_t id = 0;
+    std::string signal;
+    std::vector<Part> parts;
+    size_t count = 0;
+
+    // Part of the previous lookup, plots read sequentially
+    mutable size_t last = SIZE_MAX;
+    mutable std::shared_ptr<const Segment> segment;
+    mutable const Stream* stream = nullptr;
+    mutable size_t column = SIZE_MAX; // SIZE_MAX if the signal was not decoded in this segment
+    mutable std::vector<double> block; // Decoded block of a sealed column
+    mutable size_t blockIndex = SIZE_MAX;
+
+    size_t find(size_t index) const;
+
+public:
+    size_t size() const { return count; }
+    uint64_t time(size_t index) const;
+    double value(size_t index) const;
+    // Indices of the values with timestamps from t0 to t1, see MessageBuffer::range
+    Span range(uint64_t t0, uint64_t t1) const;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Scoped timers aggregated over the last SAMPLES samples each. Recording is lock free and costs a
+// relaxed load when profiling is disabled.
+namespace Profiler {
+    struct Statistics;
+    class Timer;
+    class Scope;
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // Timers live for the whole program, references stay valid
+    Timer& timer(const std::string& name);
+    std::vector<Statistics> statistics();
+
+    // Latency from the timestamp of the newest frame ingested since the last paint to the end of the next
+    // paint. Timestamps are ns of the host steady clock, see CAN::hostTime().
+    void markIngest(uint64_t timestamp);
+    void markPaint();
+}
+
+struct Profiler::Statistics {
+    std::string name;
+    uint64_t count; // Total samples, the percentiles cover at most the last SAMPLES
+    double mean;    // us
+    double p50;
+    double p99;
+    double max;
+};
+
+class Profiler::Timer {
+private:
+    static constexpr size_t SAMPLES = 1024;
+
+    std::string name;
+    std::atomic<uint64_t> samples[SAMPLES] = {};
+    std::atomic<uint64_t> count{0};
+
+public:
+    explicit Timer(const std::string& name) : name(name) {}
+
+    void record(uint64_t ns) {
+        samples[count.fetch_add(1, std::memory_order_relaxed) % SAMPLES].store(ns, std::memory_order_relaxed);
+    }
+
+    const std::string& getName() const { return name; }
+    Statistics statistics() const;
+};
+
+class Profiler::Scope {
+private:
+    Timer* timer;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit Scope(Timer& timer) : timer(isEnabled() ? &timer : nullptr) {
+        if (this->timer) start = std::chrono::steady_clock::now();
+    }
+
+    ~Scope() {
+        if (timer) timer->record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block, the timer is looked up once per call site
+#define PROFILE_SCOPE(name) \
+    static Profiler::Timer& PROFILE_CONCAT(profileTimer, __LINE__) = Profiler::timer(name); \
+    Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileTimer, __LINE__))
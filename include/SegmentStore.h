@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdio>
+#include <cstdint>
+
+namespace CAN {
+    class SegmentStore;
+}
+
+// Append only spill files in a directory. Blocks are written to the current file until it exceeds
+// FILE_SIZE, a file is deleted once all of its blocks are released. All files are removed on destruction.
+class CAN::SegmentStore {
+public:
+    static constexpr uint64_t FILE_SIZE = 64 << 20;
+
+    struct Location {
+        uint64_t file;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+private:
+    struct File {
+        uint64_t number;
+        uint64_t bytes = 0;
+        size_t blocks = 0; // Not yet released
+    };
+
+    std::string directory;
+    std::deque<File> files; // Oldest first, the last one takes new blocks
+    std::FILE* current = nullptr;
+    uint64_t nextFile = 0;
+    uint64_t liveBytes = 0;
+
+    std::string path(uint64_t file) const;
+    File* find(uint64_t file);
+    void removeReleased();
+
+public:
+    // Creates the directory if needed
+    explicit SegmentStore(const std::string& directory);
+    ~SegmentStore();
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    Location write(const std::vector<uint8_t>& block);
+    std::vector<uint8_t> read(const Location& location) const;
+    void release(const Location& location);
+
+    const std::string& getDirectory() const { return directory; }
+    // Bytes of blocks not yet released
+    uint64_t bytes() const { return liveBytes; }
+};
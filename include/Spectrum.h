@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+
+namespace CAN {
+    class FFT;
+    class Spectrogram;
+
+    // Linear interpolation of samples onto count points evenly spaced from t0 to t1, times in ns. Times
+    // must not decrease, points outside the samples take the value of the nearest one.
+    void resample(const uint64_t* times, const double* values, size_t samples, uint64_t t0, uint64_t t1, double* out, size_t count);
+    // Same grid as resample(), each point the mean of the interpolated samples over the step around it.
+    // The box filter keeps content above half the new rate from aliasing when there are more samples
+    // than points.
+    void downsample(const uint64_t* times, const double* values, size_t samples, uint64_t t0, uint64_t t1, double* out, size_t count);
+}
+
+// Amplitude spectrum of a fixed power of two number of real samples, with a Hann window. The real input
+// is transformed as a complex sequence of half the size. Twiddles and the bit reversed order are computed
+// once, the butterflies of each stage run over split real and imaginary arrays so the inner loop
+// vectorizes. Not thread safe, use one per thread.
+class CAN::FFT {
+private:
+    size_t size;
+    std::vector<double> window;
+    std::vector<double> cosines; // Twiddles of the half size transform, stage after stage
+    std::vector<double> sines;
+    std::vector<double> unpackCosines; // Twiddles of the split into the real spectrum
+    std::vector<double> unpackSines;
+    std::vector<uint32_t> reversed;
+    std::vector<double> re;
+    std::vector<double> im;
+    double gain = 0; // Sum of the window
+
+    void transform();
+
+public:
+    // Throws std::runtime_error unless size is a power of two from 4 to 2^26
+    explicit FFT(size_t size);
+
+    size_t getSize() const { return size; }
+    size_t bins() const { return size / 2 + 1; }
+    // Amplitudes of bins 0 to size / 2, a sine of amplitude A on a bin reads A
+    void amplitudes(const double* samples, double* out);
+};
+
+// Short time spectra of a stream of samples, computed on its own thread as samples are pushed. Samples
+// are resampled to rate Hz, every hop samples a spectrum of the last size is added as a row of dB
+// values. Only the newest ROWS rows are kept.
+class CAN::Spectrogram {
+public:
+    static constexpr size_t ROWS = 256;
+
+private:
+    FFT fft;
+    size_t hop;
+    double rate;
+
+    // Handed from push() to the worker
+    std::vector<uint64_t> pendingTimes;
+    std::vector<double> pendingValues;
+
+    // Worker only
+    std::vector<uint64_t> times;
+    std::vector<double> values;
+    std::vector<double> uniform; // Resampled, the last size are the next window
+    std::vector<double> spectrum;
+    uint64_t origin = 0;         // Time of the first uniform sample, ns
+    uint64_t index = 0;          // Of the next uniform sample
+    bool started = false;
+    double lastValue = 0;
+    uint64_t lastTime = 0;
+    size_t due = 0;              // Uniform samples until the next row
+
+    std::vector<float> rowData;  // Ring of ROWS rows
+    std::vector<float> rowLow;   // Range of each row, so the range of the ring follows dropped rows
+    std::vector<float> rowHigh;
+    size_t first = 0;            // Oldest row
+    size_t count = 0;
+    float low = 0;
+    float high = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+    bool stopping = false;
+
+    void work();
+    // Resamples times and values, adds a row every hop samples
+    void feed();
+    void addRow();
+
+public:
+    // Throws std::runtime_error for sizes FFT does not take
+    Spectrogram(size_t size, double rate);
+    ~Spectrogram();
+
+    Spectrogram(const Spectrogram&) = delete;
+    Spectrogram& operator=(const Spectrogram&) = delete;
+
+    // Samples in time order, later pushes continue earlier ones
+    void push(const uint64_t* times, const double* values, size_t count);
+    // Copies the rows oldest first, bins() values each, and the range of their values. Returns the rows.
+    size_t rows(std::vector<float>& out, float& low, float& high) const;
+    size_t bins() const { return fft.bins(); }
+    double getRate() const { return rate; }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include "CAN.h"
+#include "Database.h"
+
+namespace CAN {
+    struct IDStatistics;
+    struct ChannelStatistics;
+    class BusStatistics;
+    class QuantileEstimator;
+    class RunningStatistics;
+    class SignalStatistics;
+}
+
+// Constant size per ID, cycle times are in us
+struct CAN::IDStatistics {
+    unsigned long id = 0;
+    unsigned long flags = 0;     // MSG_FLAG_EXTENDED and MSG_FLAG_FD of the last frame
+    uint64_t count = 0;
+    uint64_t bits = 0;           // Nominal and data phase bits including stuffing
+    double rate = 0;             // Frames/s over the last window
+    double load = 0;             // Share of the bus over the last window
+    double cycleMean = 0;        // us
+    double cycleMin = 0;
+    double cycleMax = 0;
+    double jitter = 0;           // Standard deviation of the cycle time, us
+    uint64_t dlcViolations = 0;  // Length differs from the database, or from the first frame without one
+    uint64_t gaps = 0;           // Cycles over 1.5 times the expected cycle time, a dropped frame doubles it
+    uint64_t lastTimestamp = 0; // ns
+    uint8_t expectedLength = 0;
+
+private:
+    friend class BusStatistics;
+    double cycleM2 = 0;
+    uint64_t cycles = 0;
+    uint64_t windowCount = 0;
+    double windowTime = 0;       // Bus time in the current window, s
+};
+
+struct CAN::ChannelStatistics {
+    uint64_t frames = 0;
+    uint64_t errorFrames = 0;
+    uint64_t bits = 0;
+    double framesPerSecond = 0;  // Over the last window
+    double load = 0;
+    double peakLoad = 0;
+
+    // Driver counters, only set for devices that report them
+    bool hasDriver = false;
+    unsigned long overruns = 0;
+    unsigned long busWarnings = 0;
+    unsigned long busOff = 0;
+};
+
+// Per ID and per channel statistics fed from the ingest stream, one instance per channel. Windows of
+// WINDOW ns are closed by frame timestamps, an idle bus keeps the last window's rates. Not thread safe.
+class CAN::BusStatistics {
+private:
+    static constexpr uint64_t WINDOW = 1000000000; // ns
+    static constexpr uint64_t MIN_CYCLES = 8;        // Before the mean cycle time is trusted for gaps
+
+    DatabaseReader database;
+    unsigned long bitrate;
+    unsigned long dataBitrate;
+
+    std::unordered_map<uint64_t, IDStatistics> ids;
+    ChannelStatistics channel;
+
+    bool started = false;
+    uint64_t windowStart = 0;
+    uint64_t windowFrames = 0;
+    double windowTime = 0;
+
+    void closeWindow(uint64_t now);
+
+public:
+    BusStatistics(const DatabaseStore* database = nullptr, unsigned long bitrate = 500000, unsigned long dataBitrate = 2000000);
+
+    void setBitrate(unsigned long bitrate, unsigned long dataBitrate);
+    void add(const Frame& frame);
+    void add(const Frame* frames, size_t count);
+    // Overrun and bus state counters from the driver
+    void merge(const CANALSTATISTICS& driver);
+    void reset();
+
+    const ChannelStatistics& getChannel() const { return channel; }
+    // Sorted by ID
+    std::vector<IDStatistics> getIDs() const;
+};
+
+// Streaming estimate of one quantile by the P² algorithm: five markers whose heights are adjusted with a
+// parabolic fit as samples arrive. Constant memory and time per sample, exact for the first five.
+class CAN::QuantileEstimator {
+private:
+    double quantile;
+    double heights[5] = {};
+    double positions[5] = {};
+    double desired[5] = {};
+    double increments[5] = {};
+    uint64_t count = 0;
+
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+
+public:
+    explicit QuantileEstimator(double quantile = 0.5);
+
+    void add(double x);
+    // NaN before the first sample
+    double value() const;
+};
+
+// Count, min, max, mean and variance by Welford's method and estimates of the QUANTILES, O(1) per
+// sample. NaN samples are skipped.
+class CAN::RunningStatistics {
+public:
+    static constexpr double QUANTILES[] = {0.05, 0.5, 0.95};
+
+private:
+    uint64_t count = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double m2 = 0;
+    QuantileEstimator quantiles[3] = {QuantileEstimator(QUANTILES[0]), QuantileEstimator(QUANTILES[1]), QuantileEstimator(QUANTILES[2])};
+
+public:
+    void add(double x);
+
+    uint64_t getCount() const { return count; }
+    double getMin() const { return count ? min : std::nan(""); }
+    double getMax() const { return count ? max : std::nan(""); }
+    double getMean() const { return count ? mean : std::nan(""); }
+    double getStddev() const { return count > 1 ? std::sqrt(m2 / (count - 1)) : std::nan(""); }
+    // Estimate of QUANTILES[index]
+    double getQuantile(size_t index) const { return quantiles[index].value(); }
+};
+
+// Running statistics of the signals of plotted messages over the whole capture, fed the stored frames.
+// A message is followed from its first frame after it is plotted and restarts when its signal count
+// changes. Not thread safe.
+class CAN::SignalStatistics {
+private:
+    DatabaseReader database;
+    std::unordered_map<unsigned long, std::vector<RunningStatistics>> ids; // One per signal of the description
+    std::vector<double> values;
+
+public:
+    explicit SignalStatistics(const DatabaseStore* database = nullptr);
+
+    void add(const Frame* frames, size_t count);
+    void reset() { ids.clear(); }
+
+    // nullptr for messages not followed
+    const RunningStatistics* get(unsigned long id, size_t signal) const;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "CAN.h"
+#include "Device.h"
+
+namespace CAN {
+    struct SyntheticOptions;
+    class SyntheticGenerator;
+    class SimulatedDevice;
+
+    // Random database of little and big endian signals with cycle times between 10 ms and 1 s
+    Database syntheticDatabase(const SyntheticOptions& options);
+}
+
+struct CAN::SyntheticOptions {
+    size_t messages = 100;
+    size_t signalsPerMessage = 8;
+    double fdRatio = 0.0;  // Fraction of 64 byte FD messages
+    unsigned seed = 1;
+};
+
+// Produces the traffic a bus with the database's messages would carry, in timestamp order. Signals
+// follow slow sine waves between their min and max. Timestamps are in ns from 0.
+class CAN::SyntheticGenerator {
+private:
+    struct Stream {
+        const MessageDescription* description;
+        uint64_t period;
+        uint64_t next;
+        std::vector<double> frequencies;
+        std::vector<double> values;
+    };
+
+    Database database;
+    std::vector<Stream> streams;
+    std::vector<size_t> heap; // Min-heap of stream indices by next
+
+public:
+    explicit SyntheticGenerator(const Database& database);
+
+    Frame next();
+    void fill(Frame* frames, size_t count);
+    uint64_t nextTime() const;
+};
+
+// Device which plays a SyntheticGenerator in real time
+class CAN::SimulatedDevice : public CAN::Device {
+private:
+    SyntheticGenerator generator;
+    std::chrono::steady_clock::time_point start;
+    uint64_t origin; // start in ns
+
+public:
+    explicit SimulatedDevice(const Database& database);
+
+    bool receive(Frame& frame) override;
+    bool receive(Frame& frame, unsigned long timeout) override;
+
+    // Transmitted frames are accepted and dropped
+    int send(const Frame&) override { return CANAL_ERROR_SUCCESS; }
+    int send(const Frame&, unsigned long) override { return CANAL_ERROR_SUCCESS; }
+
+    bool supportsFD() const override { return true; }
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+#include <string>
+#include "CAN.h"
+#include "Device.h"
+
+namespace CAN {
+    struct PeriodicMessage;
+    struct TransmitStatistics;
+    class TransmitScheduler;
+    struct BulkStatistics;
+    class BulkTransmitter;
+
+    // Reads frames in candump's compact format, one per line ("123#DEADBEEF", FD as "123##1DEADBEEF").
+    // Blank lines and lines starting with '#' or ';' are skipped. Throws std::runtime_error naming the
+    // line of a malformed frame.
+    std::vector<Frame> loadFrames(const std::string& filename);
+    // Frames with a fixed id and an incrementing counter in the payload
+    std::vector<Frame> generateFrames(unsigned long id, size_t count, size_t length, bool bitrateSwitch = false);
+}
+
+struct CAN::PeriodicMessage {
+    MessageDescription description;
+    std::vector<double> values;   // One physical value per signal
+    unsigned long cycleTime = 100; // ms, 0 only sends on change
+    unsigned long offset = 0;      // ms before the first send
+    unsigned long count = 0;       // Number of periodic sends, 0 is unlimited
+    bool onChange = false;         // Also send immediately when values change
+    bool bitrateSwitch = false;
+};
+
+struct CAN::TransmitStatistics {
+    uint64_t sent = 0;
+    uint64_t late = 0;     // Sent more than LATE_THRESHOLD after the deadline
+    uint64_t missed = 0;   // Cycles skipped because the scheduler fell behind
+    uint64_t errors = 0;   // Sends rejected by the device
+    double meanJitter = 0; // us
+    double maxJitter = 0;  // us
+
+    void record(double jitter);
+};
+
+// Sends periodic messages from its own thread. Deadlines are kept in a hierarchical timing wheel
+// (256 x 100 us, 64 x 25.6 ms, 64 x 1.6 s) and hit by sleeping until shortly before and spinning.
+class CAN::TransmitScheduler {
+private:
+    struct Entry {
+        int id;
+        int64_t deadline; // ns since start
+        bool periodic;
+    };
+
+    struct Job {
+        PeriodicMessage message;
+        unsigned long remaining;
+        TransmitStatistics statistics;
+    };
+
+    static constexpr int64_t TICK = 100000; // ns
+    static constexpr int LEVEL0_BITS = 8;
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr int64_t LATE_THRESHOLD = 1000000; // ns
+    static constexpr int64_t SPIN_MARGIN = 2000000;    // ns
+
+    std::vector<Entry> level0[1 << LEVEL0_BITS];
+    std::vector<Entry> level1[1 << LEVEL_BITS];
+    std::vector<Entry> level2[1 << LEVEL_BITS];
+    int64_t currentTick = 0;
+    size_t pending = 0;
+
+    std::unordered_map<int, Job> jobs;
+    int nextID = 0;
+    TransmitStatistics total;
+
+    std::shared_ptr<Device> device;
+    std::chrono::steady_clock::time_point start;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    int64_t now() const;
+    void insert(const Entry& entry);
+    void schedule(const Entry& entry);
+    void cascade(std::vector<Entry>& slot);
+    int64_t nextTick() const;
+    void advance(int64_t tick, std::vector<Entry>& due);
+    void send(const Entry& entry, Job& job);
+    void run();
+
+public:
+    TransmitScheduler();
+    ~TransmitScheduler();
+
+    TransmitScheduler(const TransmitScheduler&) = delete;
+    TransmitScheduler& operator=(const TransmitScheduler&) = delete;
+
+    void setDevice(std::shared_ptr<Device> device);
+
+    int add(const PeriodicMessage& message);
+    void remove(int id);
+    void clear();
+    // Replaces the values of a message, sends immediately if it is on change
+    void update(int id, const std::vector<double>& values);
+
+    std::vector<int> ids() const;
+    PeriodicMessage message(int id) const;
+    TransmitStatistics statistics(int id) const;
+    TransmitStatistics statistics() const;
+
+    void stop();
+};
+
+struct CAN::BulkStatistics {
+    size_t queued = 0;
+    size_t sent = 0;
+    uint64_t retries = 0;  // Batches deferred because the device FIFO was full
+    int error = CANAL_ERROR_SUCCESS; // Error which aborted the transfer
+    double elapsed = 0;    // s
+    double busTime = 0;    // s the sent frames occupied the bus
+    bool running = false;
+
+    double framesPerSecond() const { return elapsed > 0 ? sent / elapsed : 0; }
+    double busLoad() const { return elapsed > 0 ? busTime / elapsed : 0; }
+};
+
+// Pushes a frame sequence to the device as fast as it accepts it. Full transmit FIFOs are
+// retried with exponential backoff so no frame is dropped, any other error aborts the transfer.
+class CAN::BulkTransmitter {
+private:
+    static constexpr size_t BATCH = 32;
+
+    std::vector<Frame> frames;
+    BulkStatistics stats;
+    std::shared_ptr<Device> device;
+    unsigned long bitrate = 500000;
+    unsigned long dataBitrate = 2000000;
+
+    mutable std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> cancelled{false};
+
+    void run();
+
+public:
+    BulkTransmitter() = default;
+    ~BulkTransmitter();
+
+    BulkTransmitter(const BulkTransmitter&) = delete;
+    BulkTransmitter& operator=(const BulkTransmitter&) = delete;
+
+    void setDevice(std::shared_ptr<Device> device);
+    // Bitrates in bit/s, used for the bus utilization
+    void setBitrate(unsigned long bitrate, unsigned long dataBitrate);
+
+    void start(std::vector<Frame> frames);
+    void cancel();
+
+    BulkStatistics statistics() const;
+};
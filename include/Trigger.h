@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "CAN.h"
+#include "Filter.h"
+#include "Log.h"
+
+// Re-arming policies
+#define TRIGGER_SINGLE 0    // Capture once, then stop
+#define TRIGGER_REARM 1     // Arm again holdoff after each capture ends
+#define TRIGGER_RETRIGGER 2 // Like REARM, and triggers during a capture extend its post-trigger window
+
+namespace CAN {
+    struct TriggerOptions;
+    class TriggerCapture;
+}
+
+// Times are in ns
+struct CAN::TriggerOptions {
+    uint64_t preTrigger = 5000000000;
+    uint64_t postTrigger = 5000000000;
+    int policy = TRIGGER_SINGLE;
+    uint64_t holdoff = 0;
+    size_t maxTriggers = 0;      // 0 is unlimited
+    size_t ringFrames = 1 << 18; // Bounds the pre-trigger ring when the bus is busier than preTrigger allows for
+};
+
+// Keeps the last preTrigger of traffic in a ring and writes it, the triggering frame and the following
+// postTrigger to a new log file whenever the trigger expression becomes true. The expression is
+// edge triggered per channel and id, so "Speed > 100" fires when the signal crosses 100, not on every
+// frame above it. Windows are closed by frame timestamps, frames of several channels may arrive out of
+// timestamp order. add() and flush() pass on the std::runtime_error of a log file that cannot be
+// written. Not thread safe.
+class CAN::TriggerCapture {
+private:
+    enum State { ARMED, CAPTURING, HOLDOFF, DONE };
+
+    std::string basename;
+    Filter trigger;
+    TriggerOptions options;
+
+    std::vector<Frame> ring;
+    size_t head = 0;  // Oldest frame
+    size_t count = 0;
+    std::unordered_map<uint64_t, bool> lastMatch;
+
+    State state = ARMED;
+    std::unique_ptr<LogWriter> writer;
+    uint64_t stateStart = 0; // Capture end during holdoff
+    uint64_t triggerTime = 0;
+    size_t triggers = 0;
+    std::vector<std::string> files;
+
+    bool fired(const Frame& frame);
+    void push(const Frame& frame);
+    void start(const Frame& frame);
+    void finish(uint64_t now);
+
+public:
+    TriggerCapture(const std::string& basename, const Filter& trigger, const TriggerOptions& options = TriggerOptions());
+
+    void add(const Frame& frame);
+    void add(const Frame* frames, size_t count);
+    // Ends a capture in progress, e.g. on shutdown before the post-trigger window has passed
+    void flush();
+
+    bool isArmed() const { return state == ARMED; }
+    bool isCapturing() const { return state == CAPTURING; }
+    bool isDone() const { return state == DONE; }
+    size_t getTriggers() const { return triggers; }
+    const std::vector<std::string>& getFiles() const { return files; }
+};
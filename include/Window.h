@@ -7,6 +7,7 @@ class Window {
 private:
     GLFWwindow* pWindow;
     int width, height;
+    bool showProfiler = false;
 
     void createImGui();
     void createSettingsTab();
@@ -14,8 +15,10 @@ private:
     void createTransmitTab();
     void createMonitorTab();
     void createGraphTab();
+    void createStatisticsTab();
+    void createProfilerOverlay();
 
-    std::string openFileDialog();
+    std::string openFileDialog(const char* filter = "DBC Files\0*.dbc\0");
 
 public:
     Window(int width, int height, const char* title);
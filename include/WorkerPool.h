@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+namespace CAN {
+    class WorkerPool;
+}
+
+// Fixed set of threads that all run the same job at once, the calling thread takes part as worker 0.
+// Jobs split their work by worker number, run() returns once every worker is done.
+class CAN::WorkerPool {
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable finished;
+    const std::function<void(size_t)>* job = nullptr;
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    void work(size_t worker);
+
+public:
+    explicit WorkerPool(size_t workers);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return threads.size() + 1; }
+    // Calls job(worker) for every worker from 0 to size() - 1. Not reentrant.
+    void run(const std::function<void(size_t)>& job);
+};
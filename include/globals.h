@@ -3,17 +3,48 @@
 #include <map>
 #include <deque>
 #include <string>
+#include <memory>
 #include "CAN.h"
+#include "MessageBuffer.h"
+#include "Device.h"
+#include "Transmit.h"
+#include "Statistics.h"
+#include "Filter.h"
+#include "MathChannel.h"
+#include "Database.h"
 
-inline long handle = NULL;
+inline std::shared_ptr<CAN::Device> device;
 
 inline const int baudrates[] = {20, 50, 100, 125, 250, 500, 800, 1000};
 inline int baudrate = 500;
 
-inline std::map<int, CAN::MessageDescription> messageDescriptions;
-inline CAN::MessageBuffer messageBuffer(5000);
+// Edited by the Database tab, read through snapshots everywhere else
+inline CAN::DatabaseStore messageDatabase;
+inline int bufferBudget = 512; // MB
+inline CAN::MessageBuffer messageBuffer(static_cast<size_t>(bufferBudget) << 20, &messageDatabase);
+inline bool spillEnabled = false;
+inline std::string spillDirectory = "spill";
+inline int spillBudget = 16; // GB
+inline int decodeThreads = 1;
+inline CAN::TransmitScheduler transmitScheduler;
+inline CAN::BulkTransmitter bulkTransmitter;
+// One per channel, by the obid of its frames, added as channels appear
+inline std::map<unsigned long, CAN::BusStatistics> busStatistics;
+inline unsigned long busBitrate = 500000;
+inline unsigned long busDataBitrate = 2000000;
+// Whole capture statistics of the plotted signals, fed the stored frames
+inline CAN::SignalStatistics signalStatistics(&messageDatabase);
+
+// Applied on ingest, drops frames that do not match or tags those that do
+inline CAN::Filter ingestFilter;
+inline bool filterTags = false;
+
+// Fed the frames stored in messageBuffer, trimmed to what it holds
+inline std::vector<CAN::MathChannel> mathChannels;
 
 typedef std::vector<std::pair<unsigned long, float>> Plot;
 inline std::vector<Plot> plots;
 
-inline bool isPaused = true;
\ No newline at end of file
+// Capture always runs, pausing freezes the views at the sequence number of the buffer at the time
+inline bool isPaused = false;
+inline uint64_t pausedSequence = 0;
\ No newline at end of file
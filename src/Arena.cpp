@@ -0,0 +1,32 @@
+#include "Arena.h"
+
+#include <cstdint>
+#include <algorithm>
+
+void* CAN::Arena::allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t padding = position ? (alignment - reinterpret_cast<uintptr_t>(position) % alignment) % alignment : 0;
+    if (!position || padding + bytes > remaining) {
+        // Blocks from new[] are aligned for any fundamental type
+        size_t size = std::max(bytes, BLOCK);
+        blocks.emplace_back(new std::byte[size]);
+        reserved += size;
+        if (size > BLOCK) return blocks.back().get(); // The current block keeps taking small requests
+        position = blocks.back().get();
+        remaining = size;
+        padding = 0;
+    }
+    void* pointer = position + padding;
+    position += padding + bytes;
+    remaining -= padding + bytes;
+    return pointer;
+}
+
+void CAN::Arena::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    blocks.clear();
+    blocks.shrink_to_fit();
+    position = nullptr;
+    remaining = 0;
+    reserved = 0;
+}
@@ -1,126 +1,438 @@
 #include "CAN.h"
-
-#include "globals.h"
+#include "Profiler.h"
 
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+CAN::Frame::Frame(const CANALMSG& canalMessage) : flags(canalMessage.flags),
+                                                  obid(canalMessage.obid),
+                                                  id(canalMessage.id),
+                                                  sizeData(std::min<unsigned char>(canalMessage.sizeData, CLASSIC_DATA_LENGTH)),
+                                                  timestamp(canalMessage.timestamp) {
+    std::memcpy(data, canalMessage.data, sizeData);
+}
 
-CAN::Message::Message(const CANALMSG& canalMessage) : flags(canalMessage.flags),
-                                                      obid(canalMessage.obid),
-                                                      id(canalMessage.id),
-                                                      sizeData(canalMessage.sizeData),
-                                                      timestamp(canalMessage.timestamp) {
-    for (int i = 0; i < sizeData; i++) {
-        rawData.push_back(canalMessage.data[i]);
+size_t CAN::fdLength(size_t length) {
+    static const size_t lengths[] = {12, 16, 20, 24, 32, 48, 64};
+    if (length <= CLASSIC_DATA_LENGTH) return length;
+    for (size_t l : lengths) {
+        if (length <= l) return l;
     }
-    
-    // TODO: Use catch with specific error instead of duplicate checking
-    if (messageDescriptions.find(id) != messageDescriptions.end()) decode();
+    return MAX_DATA_LENGTH;
 }
 
-void CAN::Message::decode() {
-    auto it = messageDescriptions.find(id);
-    if (it == messageDescriptions.end()) throw std::runtime_error("No message description found for this message");
+namespace {
+    // Stuffing and CRC-15 over the stuffed part of a frame, fed MSB first. The stuffing state is
+    // last * 5 + run where run 0 means no run yet, tables advance the state and CRC a byte at a time.
+    struct BitStream {
+        unsigned size = 0;
+        unsigned stuffed = 0;
+        uint8_t state = 0;
+        uint16_t crc = 0;
+
+        struct Tables {
+            uint8_t stuff[10][256]; // Next state in the low nibble, stuff bits in the high nibble
+            uint16_t crc[256];
+
+            Tables() {
+                for (uint8_t state = 0; state < 10; ++state) {
+                    for (unsigned byte = 0; byte < 256; ++byte) {
+                        uint8_t next = state;
+                        unsigned count = 0;
+                        for (int i = 7; i >= 0; --i) count += step(next, (byte >> i) & 1);
+                        stuff[state][byte] = static_cast<uint8_t>(next | (count << 4));
+                    }
+                }
+                for (unsigned byte = 0; byte < 256; ++byte) {
+                    uint16_t value = static_cast<uint16_t>(byte << 7);
+                    for (int i = 0; i < 8; ++i) value = ((value << 1) & 0x7FFF) ^ ((value & 0x4000) ? 0x4599 : 0);
+                    crc[byte] = value;
+                }
+            }
+        };
+
+        static const Tables& tables() {
+            static const Tables instance;
+            return instance;
+        }
 
-    MessageDescription& description = it->second;
-        
+        // The stuff bit has the opposite value and starts the next run
+        static unsigned step(uint8_t& state, unsigned bit) {
+            unsigned last = state / 5, run = state % 5;
+            run = (run != 0 && bit == last) ? run + 1 : 1;
+            if (run == 5) {
+                state = static_cast<uint8_t>((!bit) * 5 + 1);
+                return 1;
+            }
+            state = static_cast<uint8_t>(bit * 5 + run);
+            return 0;
+        }
 
-    for (const CAN::SignalDescription& sigDes : description.signals) {
-        decodedData[sigDes.name] = extractSignal(sigDes);
-    }
+        void push(uint64_t value, unsigned count) {
+            for (unsigned i = count; i-- > 0;) {
+                unsigned bit = (value >> i) & 1;
+                stuffed += step(state, bit);
+                bool next = bit ^ ((crc >> 14) & 1);
+                crc = (crc << 1) & 0x7FFF;
+                if (next) crc ^= 0x4599;
+            }
+            size += count;
+        }
+
+        void pushBytes(const uint8_t* data, size_t count) {
+            const Tables& table = tables();
+            for (size_t i = 0; i < count; ++i) {
+                uint8_t next = table.stuff[state][data[i]];
+                state = next & 0x0F;
+                stuffed += next >> 4;
+                crc = ((crc << 8) ^ table.crc[((crc >> 7) ^ data[i]) & 0xFF]) & 0x7FFF;
+            }
+            size += static_cast<unsigned>(count) * 8;
+        }
+
+        // Counts stuff bits from here on as if the stream started here
+        void restartStuffing() {
+            stuffed = 0;
+            state = 0;
+        }
+    };
 }
 
-CAN::Signal CAN::Message::extractSignal(const SignalDescription& sigDes) {
-    int byteStart = sigDes.startBit / 8;
-    int bitStart = 7 - (sigDes.startBit % 8);
-    int bitEnd = (sigDes.startBit + sigDes.length - 1) % 8;
+void CAN::frameBits(const Frame& frame, unsigned& nominalBits, unsigned& dataBits) {
+    // Error flag, delimiter and interframe space
+    if (frame.flags & MSG_FLAG_ERROR) {
+        nominalBits = 6 + 8 + 3;
+        dataBits = 0;
+        return;
+    }
 
-    // Extract bits
-    uint64_t value = 0;
-    const int nBytes = (sigDes.length + 7) / 8;
-    for (int i = 0; i < nBytes; ++i) {
-        int byteIndex;
-        switch (sigDes.endianess) {
-            case LITTLE_ENDIAN: byteIndex = byteStart + (nBytes - 1 - i); break;
-            case BIG_ENDIAN: byteIndex = byteStart + i; break;
+    bool extended = frame.flags & MSG_FLAG_EXTENDED;
+    bool rtr = frame.flags & MSG_FLAG_RTR;
+    size_t length = std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH);
+
+    BitStream stream;
+    stream.push(0, 1); // SOF
+    if (extended) {
+        stream.push(frame.id >> 18, 11);
+        stream.push(0b11, 2); // SRR, IDE
+        stream.push(frame.id, 18);
+    } else {
+        stream.push(frame.id, 11);
+    }
+
+    if (!frame.isFD()) {
+        stream.push(rtr, 1);
+        stream.push(0, 2); // IDE r0, or r1 r0 when extended
+        stream.push(length, 4);
+        if (!rtr) stream.pushBytes(frame.data, length);
+        stream.push(stream.crc, 15);
+
+        // CRC delimiter, ACK, ACK delimiter, EOF and interframe space are not stuffed
+        nominalBits = stream.size + stream.stuffed + 1 + 2 + 7 + 3;
+        dataBits = 0;
+        return;
+    }
+
+    // RRS, IDE (standard only), FDF, res and BRS are sent at the nominal bitrate
+    stream.push(0, extended ? 1 : 2);
+    stream.push(0b10, 2);
+    stream.push((frame.flags & MSG_FLAG_BRS) != 0, 1);
+    unsigned arbitration = stream.size;
+    unsigned arbitrationStuff = stream.stuffed;
+    stream.restartStuffing();
+
+    // ESI, DLC and data, followed by stuff count, CRC with its fixed stuff bits and CRC delimiter
+    static const uint8_t dlcs[] = {9, 10, 11, 12, 13, 14, 15};
+    uint8_t dlc = static_cast<uint8_t>(length);
+    if (length > CLASSIC_DATA_LENGTH) {
+        const size_t fdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+        for (int i = 0; i < 7; ++i) {
+            if (fdLength(length) == fdLengths[i]) dlc = dlcs[i];
         }
-        value = (value << 8) | rawData[byteIndex];
     }
+    stream.push((frame.flags & MSG_FLAG_ESI) != 0, 1);
+    stream.push(dlc, 4);
+    stream.pushBytes(frame.data, length);
+    unsigned crcBits = fdLength(length) > 16 ? 21 : 17;
+    unsigned data = stream.size - arbitration + stream.stuffed + 4 + crcBits + (4 + crcBits + 3) / 4 + 1;
+
+    nominalBits = arbitration + arbitrationStuff + 2 + 7 + 3;
+    if (frame.flags & MSG_FLAG_BRS) {
+        dataBits = data;
+    } else {
+        nominalBits += data;
+        dataBits = 0;
+    }
+}
+
+double CAN::frameTime(const Frame& frame, unsigned long bitrate, unsigned long dataBitrate) {
+    unsigned nominalBits, dataBits;
+    frameBits(frame, nominalBits, dataBits);
+    return static_cast<double>(nominalBits) / bitrate + (dataBits ? static_cast<double>(dataBits) / dataBitrate : 0.0);
+}
+
+CAN::Message::Message(const Frame& frame, const MessageDescription* description) : flags(frame.flags),
+                                            obid(frame.obid),
+                                            id(frame.id),
+                                            sizeData(frame.sizeData),
+                                            rawData(frame.data, frame.data + std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH)),
+                                            timestamp(frame.timestamp) {
+    if (description) decode(*description);
+}
+
+CAN::Message::Message(const CANALMSG& canalMessage, const MessageDescription* description) : Message(Frame(canalMessage), description) {
+
+}
+
+void CAN::SignalDescription::compile() {
+    layout = SignalLayout();
+    if (length == 0 || length > 64) return;
 
-    // Mask out bits not in range
-    value >>= (8 * nBytes - sigDes.length - bitStart);
-    value &= (1ULL << sigDes.length) - 1;
+    layout.mask = length == 64 ? ~0ULL : (1ULL << length) - 1;
 
-    // Handle signedness
-    int signedValue = static_cast<int>(value);
-    if (sigDes.signedness && (value & (1ULL << (sigDes.length - 1)))) {
-        signedValue -= (1ULL << sigDes.length);
+    int firstBit;
+    if (endianess == SIGNAL_LITTLE_ENDIAN) {
+        // Intel: startBit is the LSB, bits count upwards through the payload
+        firstBit = startBit;
+    } else {
+        // Motorola: startBit is the MSB, convert to a sequential position counted from the MSB of byte 0
+        firstBit = (startBit / 8) * 8 + (7 - startBit % 8);
     }
+    layout.byteOffset = static_cast<uint16_t>(firstBit / 8);
 
-    // Apply scale and offset
-    double result = static_cast<double>(signedValue) * sigDes.scale + sigDes.offset;
+    int relative = firstBit % 8;
+    if (relative + static_cast<int>(length) > 64) return; // Spans 9 bytes
+
+    layout.window = true;
+    layout.shift = static_cast<uint8_t>(endianess == SIGNAL_LITTLE_ENDIAN ? relative : 64 - relative - length);
+}
 
-    // Return as appropriate type
-    if (sigDes.scale == 1.0 && sigDes.offset == 0.0) {
-        return signedValue; // Treat as integer
+// Loads 8 bytes starting at offset, bytes past the end of the payload read as zero
+static uint64_t loadWindow(const uint8_t* data, size_t size, size_t offset, bool littleEndian) {
+    uint8_t bytes[8] = {};
+    if (offset + 8 <= size) std::memcpy(bytes, data + offset, 8);
+    else if (offset < size) std::memcpy(bytes, data + offset, size - offset);
+
+    uint64_t window = 0;
+    if (littleEndian) {
+        for (int i = 7; i >= 0; --i) window = (window << 8) | bytes[i];
+    } else {
+        for (int i = 0; i < 8; ++i) window = (window << 8) | bytes[i];
     }
-    return result; // Treat as float
+    return window;
 }
 
-CAN::Signal CAN::Message::getSignal(const std::string& name) const {
-    auto it = decodedData.find(name);
-    if (it == decodedData.end()) {
-        throw std::runtime_error("Variable not found: " + name);
+// Bit by bit reference extraction, used for signals which don't fit an 8 byte window
+static uint64_t extractBits(const uint8_t* data, size_t size, const CAN::SignalDescription& sigDes) {
+    uint64_t value = 0;
+    if (sigDes.endianess == SIGNAL_LITTLE_ENDIAN) {
+        for (size_t i = 0; i < sigDes.length; ++i) {
+            size_t bit = sigDes.startBit + i;
+            if (bit / 8 >= size) break;
+            value |= static_cast<uint64_t>((data[bit / 8] >> (bit % 8)) & 1) << i;
+        }
+    } else {
+        size_t position = (sigDes.startBit / 8) * 8 + (7 - sigDes.startBit % 8);
+        for (size_t i = 0; i < sigDes.length; ++i, ++position) {
+            uint8_t bit = position / 8 < size ? (data[position / 8] >> (7 - position % 8)) & 1 : 0;
+            value = (value << 1) | bit;
+        }
     }
-    return it->second;
+    return value;
+}
+
+uint64_t CAN::extractRaw(const uint8_t* data, size_t size, const SignalDescription& sigDes) {
+    const SignalLayout& layout = sigDes.layout;
+    if (!layout.window) return extractBits(data, size, sigDes);
+
+    uint64_t window = loadWindow(data, size, layout.byteOffset, sigDes.endianess == SIGNAL_LITTLE_ENDIAN);
+    return (window >> layout.shift) & layout.mask;
 }
 
-CAN::MessageBuffer::MessageBuffer(size_t maxSize) : maxSize(maxSize) {
+// Stores 8 bytes starting at offset, bytes past the end of the payload are dropped
+static void storeWindow(uint8_t* data, size_t size, size_t offset, bool littleEndian, uint64_t window) {
+    uint8_t bytes[8];
+    if (littleEndian) {
+        for (int i = 0; i < 8; ++i, window >>= 8) bytes[i] = static_cast<uint8_t>(window);
+    } else {
+        for (int i = 7; i >= 0; --i, window >>= 8) bytes[i] = static_cast<uint8_t>(window);
+    }
+
+    if (offset + 8 <= size) std::memcpy(data + offset, bytes, 8);
+    else if (offset < size) std::memcpy(data + offset, bytes, size - offset);
+}
 
+static void insertBits(uint8_t* data, size_t size, const CAN::SignalDescription& sigDes, uint64_t value) {
+    if (sigDes.endianess == SIGNAL_LITTLE_ENDIAN) {
+        for (size_t i = 0; i < sigDes.length; ++i) {
+            size_t bit = sigDes.startBit + i;
+            if (bit / 8 >= size) break;
+            data[bit / 8] = static_cast<uint8_t>((data[bit / 8] & ~(1u << (bit % 8))) | (((value >> i) & 1) << (bit % 8)));
+        }
+    } else {
+        size_t position = (sigDes.startBit / 8) * 8 + (7 - sigDes.startBit % 8);
+        for (size_t i = 0; i < sigDes.length; ++i, ++position) {
+            if (position / 8 >= size) break;
+            int shift = 7 - position % 8;
+            uint64_t bit = (value >> (sigDes.length - 1 - i)) & 1;
+            data[position / 8] = static_cast<uint8_t>((data[position / 8] & ~(1u << shift)) | (bit << shift));
+        }
+    }
 }
 
-void CAN::MessageBuffer::pop_front() {
-        messageMap[messages.front().id].pop_front();
-        messages.pop_front();
+// Converts a physical value to its raw bit pattern (range clamp, scale/offset inversion, saturation)
+static uint64_t toRaw(const CAN::SignalDescription& sigDes, double value) {
+    if (sigDes.min < sigDes.max) value = std::clamp(value, static_cast<double>(sigDes.min), static_cast<double>(sigDes.max));
+
+    if (sigDes.valueType == SIG_FLOAT && sigDes.length == 32) {
+        float f = static_cast<float>((value - sigDes.offset) / sigDes.scale);
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+    if (sigDes.valueType == SIG_DOUBLE && sigDes.length == 64) {
+        double d = (value - sigDes.offset) / sigDes.scale;
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return bits;
+    }
+
+    double raw = std::round((value - sigDes.offset) / sigDes.scale);
+    if (std::isnan(raw)) return 0;
+
+    // Past 53 bits the largest raw value is not a double, limit - 1 rounds back up to limit and the cast
+    // overflows. Out of range values saturate to the exact extremes of the bit pattern instead.
+    const CAN::SignalLayout& layout = sigDes.layout;
+    if (sigDes.signedness) {
+        double limit = std::ldexp(1.0, static_cast<int>(sigDes.length) - 1);
+        if (raw >= limit) return layout.mask >> 1;
+        if (raw <= -limit) return (layout.mask >> 1) + 1;
+        return static_cast<uint64_t>(static_cast<int64_t>(raw)) & layout.mask;
+    }
+    if (raw >= std::ldexp(1.0, static_cast<int>(sigDes.length))) return layout.mask;
+    return raw > 0 ? static_cast<uint64_t>(raw) : 0;
 }
 
-void CAN::MessageBuffer::addMessage(const Message& message) {
-    if (messages.size() == maxSize) pop_front();
+void CAN::insertSignal(uint8_t* data, size_t size, const SignalDescription& sigDes, double value) {
+    if (sigDes.length == 0 || sigDes.length > 64) return;
 
-    messages.push_back(message);
-    messageMap[message.id].push_back(&messages.back());
+    uint64_t raw = toRaw(sigDes, value);
+    const SignalLayout& layout = sigDes.layout;
+    if (!layout.window) return insertBits(data, size, sigDes, raw);
+
+    bool littleEndian = sigDes.endianess == SIGNAL_LITTLE_ENDIAN;
+    uint64_t window = loadWindow(data, size, layout.byteOffset, littleEndian);
+    window = (window & ~(layout.mask << layout.shift)) | (raw << layout.shift);
+    storeWindow(data, size, layout.byteOffset, littleEndian, window);
 }
 
-void CAN::MessageBuffer::setMaxSize(size_t maxSize) {
-    while (messages.size() > maxSize) pop_front();
+void CAN::Message::decode(const MessageDescription& description) {
+    PROFILE_SCOPE("can/decode");
+    // Multiplexed signals are only present for their switch value
+    int64_t multiplexValue = MUX_NONE;
+    for (const CAN::SignalDescription& sigDes : description.signals) {
+        if (sigDes.multiplexer) {
+            multiplexValue = static_cast<int64_t>(extractRaw(rawData.data(), rawData.size(), sigDes));
+            break;
+        }
+    }
 
-    this->maxSize = maxSize;
+    for (const CAN::SignalDescription& sigDes : description.signals) {
+        if (sigDes.multiplexValue != MUX_NONE && sigDes.multiplexValue != multiplexValue) continue;
+        decodedData[sigDes.name] = extractSignal(sigDes);
+    }
 }
 
-const std::deque<CAN::Message*>& CAN::MessageBuffer::ofID(int id) const {
-    static const std::deque<Message*> emptyQueue;
-    auto it = messageMap.find(id);
-    return it != messageMap.end() ? it->second : emptyQueue;
+void CAN::Message::encode(const MessageDescription& description, const double* values, Frame& frame) {
+    frame.id = description.id;
+    frame.sizeData = static_cast<unsigned char>(fdLength(std::min<size_t>(description.length, MAX_DATA_LENGTH)));
+    // A reused frame may still carry the flags of a longer message, callers set BRS after encoding
+    frame.flags &= ~static_cast<unsigned long>(MSG_FLAG_FD | MSG_FLAG_BRS);
+    if (frame.sizeData > CLASSIC_DATA_LENGTH) frame.flags |= MSG_FLAG_FD;
+    std::memset(frame.data, 0, sizeof(frame.data));
+
+    int64_t multiplexValue = MUX_NONE;
+    for (size_t i = 0; i < description.signals.size(); ++i) {
+        if (description.signals[i].multiplexer) {
+            multiplexValue = static_cast<int64_t>(std::llround(values[i]));
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < description.signals.size(); ++i) {
+        const SignalDescription& sigDes = description.signals[i];
+        if (sigDes.multiplexValue != MUX_NONE && sigDes.multiplexValue != multiplexValue) continue;
+        insertSignal(frame.data, frame.sizeData, sigDes, values[i]);
+    }
 }
 
-std::deque<CAN::Message>::iterator CAN::MessageBuffer::begin() {
-    return messages.begin();
+void CAN::decodeMessage(const MessageDescription& description, const uint8_t* data, size_t size, double* values) {
+    PROFILE_SCOPE("can/decode");
+    int64_t multiplexValue = MUX_NONE;
+    for (const CAN::SignalDescription& sigDes : description.signals) {
+        if (sigDes.multiplexer) {
+            multiplexValue = static_cast<int64_t>(extractRaw(data, size, sigDes));
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < description.signals.size(); ++i) {
+        const SignalDescription& sigDes = description.signals[i];
+        if (sigDes.length == 0 || sigDes.length > 64 || (sigDes.multiplexValue != MUX_NONE && sigDes.multiplexValue != multiplexValue)) {
+            values[i] = std::nan("");
+            continue;
+        }
+        values[i] = std::visit([](auto value) { return static_cast<double>(value); }, decodeSignal(sigDes, data, size));
+    }
 }
 
-std::deque<CAN::Message>::iterator CAN::MessageBuffer::end() {
-    return messages.end();
+CAN::Signal CAN::decodeSignal(const SignalDescription& sigDes, const uint8_t* data, size_t size) {
+    if (sigDes.length == 0 || sigDes.length > 64) throw std::runtime_error("Invalid signal length: " + sigDes.name);
+
+    uint64_t value = extractRaw(data, size, sigDes);
+
+    // IEEE-754 signals are reinterpreted, not sign extended
+    double result;
+    if (sigDes.valueType == SIG_FLOAT && sigDes.length == 32) {
+        float f;
+        uint32_t bits = static_cast<uint32_t>(value);
+        std::memcpy(&f, &bits, sizeof(f));
+        result = f;
+    } else if (sigDes.valueType == SIG_DOUBLE && sigDes.length == 64) {
+        std::memcpy(&result, &value, sizeof(result));
+    } else if (sigDes.signedness) {
+        // Sign extend from length bits
+        int shift = 64 - static_cast<int>(sigDes.length);
+        int64_t signedValue = static_cast<int64_t>(value << shift) >> shift;
+
+        if (sigDes.scale == 1.0 && sigDes.offset == 0.0) return signedValue; // Treat as integer
+        result = static_cast<double>(signedValue);
+    } else {
+        if (sigDes.scale == 1.0 && sigDes.offset == 0.0) return value; // Treat as integer
+        result = static_cast<double>(value);
+    }
+
+    // Apply scale and offset
+    return result * sigDes.scale + sigDes.offset;
 }
 
-std::deque<CAN::Message>::const_iterator CAN::MessageBuffer::begin() const {
-    return messages.cbegin();
+CAN::Signal CAN::Message::extractSignal(const SignalDescription& sigDes) {
+    return decodeSignal(sigDes, rawData.data(), rawData.size());
 }
 
-std::deque<CAN::Message>::const_iterator CAN::MessageBuffer::end() const {
-    return messages.cend();
+CAN::Signal CAN::Message::getSignal(const std::string& name) const {
+    auto it = decodedData.find(name);
+    if (it == decodedData.end()) {
+        throw std::runtime_error("Variable not found: " + name);
+    }
+    return it->second;
 }
 
-void CAN::parseDBC(const std::string& filename, std::map<int, CAN::MessageDescription>& dbc) {
+void CAN::parseDBC(const std::string& filename, Database& dbc) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Error opening file: " << filename << std::endl;
@@ -151,6 +463,12 @@ void CAN::parseDBC(const std::string& filename, std::map<int, CAN::MessageDescri
 
             std::string colon;
             stream >> signal.name >> colon;
+            if (colon != ":") {
+                // Multiplexing (e.g., "SG_ Mode M :" or "SG_ Value m3 :")
+                if (colon == "M") signal.multiplexer = true;
+                else if (colon[0] == 'm') signal.multiplexValue = std::stoi(colon.substr(1));
+                stream >> colon;
+            }
             
             std::string bitInfo, scalingInfo, rangeInfo, unit, receiver;
             stream >> bitInfo >> scalingInfo >> rangeInfo >> unit >> receiver;
@@ -160,7 +478,7 @@ void CAN::parseDBC(const std::string& filename, std::map<int, CAN::MessageDescri
             size_t atPos = bitInfo.find('@');
             signal.startBit = std::stoi(bitInfo.substr(0, pipePos));
             signal.length = std::stoi(bitInfo.substr(pipePos + 1, atPos - pipePos - 1));
-            signal.endianess = bitInfo[atPos + 1] == '1';
+            signal.endianess = bitInfo[atPos + 1] == '1' ? SIGNAL_LITTLE_ENDIAN : SIGNAL_BIG_ENDIAN;
             signal.signedness = bitInfo[atPos + 2] == '-';
 
             // Parse scaling and offset (e.g., "(0.1,0)")
@@ -178,8 +496,64 @@ void CAN::parseDBC(const std::string& filename, std::map<int, CAN::MessageDescri
             // signal.receiver = receiver;
 
             msg.signals.push_back(signal);
+        } else if (token == "BA_") {
+            // Attribute (e.g., "BA_ "GenMsgCycleTime" BO_ 100 10;")
+            std::string name, object;
+            int msgID;
+            unsigned long value;
+            stream >> name >> object;
+            if (name != "\"GenMsgCycleTime\"" || object != "BO_" || !(stream >> msgID >> value)) continue;
+
+            auto it = dbc.find(msgID);
+            if (it != dbc.end()) it->second.cycleTime = value;
+        } else if (token == "SIG_VALTYPE_") {
+            // Signal value type (e.g., "SIG_VALTYPE_ 100 Speed : 1;")
+            int msgID;
+            std::string name, colon, valueType;
+            stream >> msgID >> name >> colon >> valueType;
+
+            auto it = dbc.find(msgID);
+            if (it == dbc.end()) continue;
+            for (CAN::SignalDescription& signal : it->second.signals) {
+                if (signal.name == name) signal.valueType = std::stoi(valueType);
+            }
         }
     }
 
     file.close();
-}
\ No newline at end of file
+
+    for (auto& [id, msg] : dbc) {
+        for (CAN::SignalDescription& signal : msg.signals) signal.compile();
+    }
+}
+
+void CAN::writeDBC(const std::string& filename, const Database& dbc) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    file << "VERSION \"\"\n\nBU_:\n\n";
+    for (const auto& [id, msg] : dbc) {
+        file << "BO_ " << msg.id << " " << msg.name << ": " << msg.length << " " << (msg.sender.empty() ? "Vector__XXX" : msg.sender) << "\n";
+        for (const SignalDescription& signal : msg.signals) {
+            file << " SG_ " << signal.name << " ";
+            if (signal.multiplexer) file << "M ";
+            else if (signal.multiplexValue != MUX_NONE) file << "m" << signal.multiplexValue << " ";
+            file << ": " << signal.startBit << "|" << signal.length << "@" << (signal.endianess == SIGNAL_LITTLE_ENDIAN ? "1" : "0")
+                 << (signal.signedness ? "-" : "+") << " (" << signal.scale << "," << signal.offset << ") ["
+                 << signal.min << "|" << signal.max << "] \"" << signal.unit << "\" Vector__XXX\n";
+        }
+        file << "\n";
+    }
+
+    for (const auto& [id, msg] : dbc) {
+        if (msg.cycleTime > 0) file << "BA_ \"GenMsgCycleTime\" BO_ " << msg.id << " " << msg.cycleTime << ";\n";
+    }
+    for (const auto& [id, msg] : dbc) {
+        for (const SignalDescription& signal : msg.signals) {
+            if (signal.valueType != SIG_INTEGER) file << "SIG_VALTYPE_ " << msg.id << " " << signal.name << " : " << signal.valueType << ";\n";
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#include "Clock.h"
+
+#include <algorithm>
+
+CAN::TimestampAligner::TimestampAligner(double nsPerTick, int rawBits) : nsPerTick(nsPerTick), rawBits(std::min(rawBits, 64)) {}
+
+void CAN::TimestampAligner::fit(Channel& channel) {
+    const auto& minima = channel.minima;
+    double meanDevice = 0, meanOffset = 0;
+    for (const auto& [device, offset] : minima) {
+        meanDevice += device;
+        meanOffset += offset;
+    }
+    meanDevice /= minima.size();
+    meanOffset /= minima.size();
+
+    // Least squares slope, centered on the mean so large timestamps keep their precision
+    double covariance = 0, variance = 0;
+    for (const auto& [device, offset] : minima) {
+        covariance += (device - meanDevice) * (offset - meanOffset);
+        variance += (device - meanDevice) * (device - meanDevice);
+    }
+    channel.drift = variance > 0 ? std::clamp(covariance / variance, -MAX_DRIFT, MAX_DRIFT) : 0;
+    channel.offset = meanOffset;
+    channel.reference = meanDevice;
+}
+
+uint64_t CAN::TimestampAligner::align(unsigned long channelNumber, uint64_t raw, uint64_t host) {
+    uint64_t range = rawBits < 64 ? 1ULL << rawBits : 0;
+    if (range) raw &= range - 1;
+
+    auto [it, created] = channels.try_emplace(channelNumber);
+    Channel& channel = it->second;
+
+    // A counter that steps back by more than half its range has wrapped
+    if (!created && range && raw < channel.lastRaw && channel.lastRaw - raw > range / 2) channel.wraps += range;
+    channel.lastRaw = raw;
+
+    double device = static_cast<double>(channel.wraps + raw) * nsPerTick;
+    double delta = static_cast<double>(host) - device;
+
+    if (created) {
+        channel.windowStart = device;
+        channel.windowMinimum = delta;
+        channel.windowDevice = device;
+        channel.offset = delta;
+        channel.reference = device;
+    }
+
+    if (delta < channel.windowMinimum) {
+        channel.windowMinimum = delta;
+        channel.windowDevice = device;
+    }
+    if (device - channel.windowStart >= WINDOW) {
+        channel.minima.emplace_back(channel.windowDevice, channel.windowMinimum);
+        if (channel.minima.size() > WINDOWS) channel.minima.pop_front();
+        fit(channel);
+
+        channel.windowStart = device;
+        channel.windowMinimum = delta;
+        channel.windowDevice = device;
+    } else if (channel.minima.empty()) {
+        // Until the first window closes the running minimum is the best estimate
+        channel.offset = channel.windowMinimum;
+        channel.reference = device;
+    }
+
+    // A frame cannot arrive before it was stamped, a lower delta than the model means the model is late
+    double offset = std::min(channel.offset + channel.drift * (device - channel.reference), delta);
+    double aligned = std::max(device + offset, 0.0);
+    channel.last = std::max(channel.last, static_cast<uint64_t>(aligned));
+    return channel.last;
+}
@@ -0,0 +1,421 @@
+#include "Codec.h"
+
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Control bytes of packed data: below ZERO_RUN n + 1 literal bytes follow, from ZERO_RUN on n - ZERO_RUN + 1 zeros
+#define ZERO_RUN 0x80
+#define MAX_RUN 128
+
+// Column block encodings
+#define BLOCK_XOR 0
+#define BLOCK_INTEGER 1
+#define BLOCK_NAN 0x80 // Integer block holding NaNs
+
+// Integers beyond 2^53 are not exact in a double
+#define MAX_EXACT 9007199254740992.0
+
+static int leadingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    return _BitScanReverse64(&index, value) ? 63 - static_cast<int>(index) : 64;
+#else
+    return value ? __builtin_clzll(value) : 64;
+#endif
+}
+
+static int trailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    return _BitScanForward64(&index, value) ? static_cast<int>(index) : 64;
+#else
+    return value ? __builtin_ctzll(value) : 64;
+#endif
+}
+
+static uint64_t lowBits(int count) {
+    return count >= 64 ? ~0ULL : (1ULL << count) - 1;
+}
+
+// Most significant bit first, padded to a whole byte by flush
+class BitWriter {
+private:
+    std::vector<uint8_t>& out;
+    uint64_t pending = 0;
+    int bits = 0;
+
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void write(uint64_t value, int count) {
+        if (count > 32) {
+            write(value >> 32, count - 32);
+            count = 32;
+        }
+        pending = (pending << count) | (value & lowBits(count));
+        bits += count;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<uint8_t>(pending >> bits));
+        }
+        pending &= lowBits(bits);
+    }
+
+    void flush() {
+        if (bits > 0) out.push_back(static_cast<uint8_t>(pending << (8 - bits)));
+        pending = 0;
+        bits = 0;
+    }
+};
+
+class BitReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    uint64_t pending = 0;
+    int bits = 0;
+
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint64_t read(int count) {
+        if (count > 32) {
+            uint64_t high = read(count - 32);
+            return (high << 32) | read(32);
+        }
+        while (bits < count) {
+            if (position >= size) throw std::runtime_error("Codec: unexpected end of bit stream");
+            pending = (pending << 8) | data[position++];
+            bits += 8;
+        }
+        bits -= count;
+        return (pending >> bits) & lowBits(count);
+    }
+
+    bool bit() { return read(1) != 0; }
+    // Whole bytes taken, the padding of the last one included
+    size_t consumed() const { return position; }
+};
+
+void Codec::Writer::put(uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i, value >>= 8) out.push_back(static_cast<uint8_t>(value));
+}
+
+void Codec::Writer::putVarint(uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void Codec::Writer::putBytes(const uint8_t* data, size_t size) {
+    out.insert(out.end(), data, data + size);
+}
+
+void Codec::Writer::putString(const std::string& value) {
+    putVarint(value.size());
+    putBytes(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+}
+
+void Codec::Writer::putPacked(const uint8_t* data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 0;
+        while (i + run < size && run < MAX_RUN && data[i + run] == 0) run++;
+        if (run > 0) {
+            out.push_back(static_cast<uint8_t>(ZERO_RUN + run - 1));
+            i += run;
+            continue;
+        }
+
+        // Literals end at the next zero, a single zero between literals is cheaper kept inline
+        size_t literal = 0;
+        while (i + literal < size && literal < MAX_RUN &&
+               (data[i + literal] != 0 || (i + literal + 1 < size && data[i + literal + 1] != 0))) {
+            literal++;
+        }
+        out.push_back(static_cast<uint8_t>(literal - 1));
+        out.insert(out.end(), data + i, data + i + literal);
+        i += literal;
+    }
+}
+
+void Codec::Reader::need(size_t bytes) const {
+    if (size - position < bytes) throw std::runtime_error("Codec: unexpected end of data");
+}
+
+uint64_t Codec::Reader::get(int bytes) {
+    need(bytes);
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | data[position + i];
+    position += bytes;
+    return value;
+}
+
+uint64_t Codec::Reader::getVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        need(1);
+        uint8_t byte = data[position++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("Codec: varint too long");
+}
+
+void Codec::Reader::getBytes(uint8_t* out, size_t count) {
+    need(count);
+    std::memcpy(out, data + position, count);
+    position += count;
+}
+
+std::string Codec::Reader::getString() {
+    size_t length = getVarint();
+    need(length);
+    std::string value(reinterpret_cast<const char*>(data + position), length);
+    position += length;
+    return value;
+}
+
+void Codec::Reader::getPacked(uint8_t* out, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+        need(1);
+        uint8_t control = data[position++];
+        size_t run = (control & (ZERO_RUN - 1)) + 1;
+        if (run > count - i) throw std::runtime_error("Codec: packed run past the end");
+
+        if (control >= ZERO_RUN) std::memset(out + i, 0, run);
+        else getBytes(out + i, run);
+        i += run;
+    }
+}
+
+void Codec::Writer::putTimestamps(const uint64_t* values, size_t count) {
+    if (count == 0) return;
+    BitWriter bits(out);
+    bits.write(values[0], 64);
+
+    // Buckets for the zigzagged change of the interval, widths from 0 to 64 bits
+    int64_t previous = 0;
+    for (size_t i = 1; i < count; ++i) {
+        int64_t delta = static_cast<int64_t>(values[i] - values[i - 1]);
+        uint64_t change = zigzag(delta - previous);
+        previous = delta;
+
+        if (change == 0) bits.write(0, 1);
+        else if (change < (1 << 7)) { bits.write(0b10, 2); bits.write(change, 7); }
+        else if (change < (1 << 12)) { bits.write(0b110, 3); bits.write(change, 12); }
+        else if (change < (1 << 20)) { bits.write(0b1110, 4); bits.write(change, 20); }
+        else { bits.write(0b1111, 4); bits.write(change, 64); }
+    }
+    bits.flush();
+}
+
+void Codec::Reader::getTimestamps(uint64_t* out, size_t count) {
+    if (count == 0) return;
+    BitReader bits(data + position, size - position);
+    out[0] = bits.read(64);
+
+    int64_t delta = 0;
+    for (size_t i = 1; i < count; ++i) {
+        uint64_t change = 0;
+        if (bits.bit()) {
+            if (!bits.bit()) change = bits.read(7);
+            else if (!bits.bit()) change = bits.read(12);
+            else if (!bits.bit()) change = bits.read(20);
+            else change = bits.read(64);
+        }
+        delta += unzigzag(change);
+        out[i] = out[i - 1] + static_cast<uint64_t>(delta);
+    }
+    position += bits.consumed();
+}
+
+static uint64_t bitsOf(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Raw integer of a value decoded as raw * scale + offset, false unless that gives back the same bits
+static bool rawInteger(double value, double scale, double offset, int64_t& raw) {
+    double estimate = std::round((value - offset) / scale);
+    if (!(std::fabs(estimate) < MAX_EXACT)) return false;
+    raw = static_cast<int64_t>(estimate);
+    return bitsOf(static_cast<double>(raw) * scale + offset) == bitsOf(value);
+}
+
+static void encodeBlock(const double* values, size_t count, double scale, double offset, std::vector<uint8_t>& out) {
+    // Absent multiplexed signals are the NaN of std::nan, other NaNs have to go through XOR
+    const uint64_t absent = bitsOf(std::nan(""));
+    bool integers = true, nans = false, first = true;
+    int64_t minimum = 0, maximum = 0;
+    for (size_t i = 0; i < count && integers; ++i) {
+        int64_t raw;
+        if (bitsOf(values[i]) == absent) nans = true;
+        else if (!rawInteger(values[i], scale, offset, raw)) integers = false;
+        else {
+            minimum = first ? raw : std::min(minimum, raw);
+            maximum = first ? raw : std::max(maximum, raw);
+            first = false;
+        }
+    }
+
+    Codec::Writer writer(out);
+    if (integers) {
+        // NaN takes the all ones code, one past the range at least
+        uint64_t range = static_cast<uint64_t>(maximum - minimum) + (nans ? 1 : 0);
+        int width = 64 - leadingZeros(range);
+        uint64_t nan = lowBits(width);
+        writer.put(BLOCK_INTEGER | (nans ? BLOCK_NAN : 0), 1);
+        writer.putVarint(Codec::zigzag(minimum));
+        writer.put(static_cast<uint64_t>(width), 1);
+
+        BitWriter bits(out);
+        if (width > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                int64_t raw = 0;
+                if (bitsOf(values[i]) == absent) bits.write(nan, width);
+                else if (rawInteger(values[i], scale, offset, raw)) bits.write(static_cast<uint64_t>(raw - minimum), width);
+            }
+        }
+        bits.flush();
+        return;
+    }
+    writer.put(BLOCK_XOR, 1);
+    BitWriter bits(out);
+    uint64_t previous;
+    std::memcpy(&previous, &values[0], sizeof(previous));
+    bits.write(previous, 64);
+
+    int windowLeading = -1, windowTrailing = 0;
+    for (size_t i = 1; i < count; ++i) {
+        uint64_t value;
+        std::memcpy(&value, &values[i], sizeof(value));
+        uint64_t x = value ^ previous;
+        previous = value;
+
+        if (x == 0) {
+            bits.write(0, 1);
+            continue;
+        }
+        int leading = std::min(leadingZeros(x), 31);
+        int trailing = trailingZeros(x);
+        if (windowLeading >= 0 && leading >= windowLeading && trailing >= windowTrailing) {
+            // Fits the previous window
+            bits.write(0b10, 2);
+            bits.write(x >> windowTrailing, 64 - windowLeading - windowTrailing);
+        } else {
+            int significant = 64 - leading - trailing;
+            bits.write(0b11, 2);
+            bits.write(static_cast<uint64_t>(leading), 5);
+            bits.write(static_cast<uint64_t>(significant - 1), 6);
+            bits.write(x >> trailing, significant);
+            windowLeading = leading;
+            windowTrailing = trailing;
+        }
+    }
+    bits.flush();
+}
+
+Codec::Column::Column(const double* values, size_t count, double scale, double offset)
+    : count(count), scale(scale != 0 ? scale : 1.0), offset(offset) {
+    // Encoded into a per thread buffer and copied once, growing data would allocate for every doubling
+    static thread_local std::vector<uint8_t> encoded;
+    encoded.clear();
+    blocks.reserve((count + BLOCK - 1) / BLOCK);
+    for (size_t start = 0; start < count; start += BLOCK) {
+        blocks.push_back(static_cast<uint32_t>(encoded.size()));
+        encodeBlock(values + start, std::min(BLOCK, count - start), this->scale, offset, encoded);
+    }
+    data.assign(encoded.begin(), encoded.end());
+}
+
+size_t Codec::Column::decode(size_t block, double* out) const {
+    if (block >= blocks.size()) throw std::out_of_range("Column block out of range");
+    size_t values = std::min(BLOCK, count - block * BLOCK);
+    size_t end = block + 1 < blocks.size() ? blocks[block + 1] : data.size();
+    const uint8_t* begin = data.data() + blocks[block];
+    size_t size = end - blocks[block];
+    if (size == 0) throw std::runtime_error("Codec: empty column block");
+
+    if ((begin[0] & ~BLOCK_NAN) == BLOCK_INTEGER) {
+        Reader reader(begin + 1, size - 1);
+        int64_t minimum = unzigzag(reader.getVarint());
+        int width = static_cast<int>(reader.get(1));
+        if (width > 64) throw std::runtime_error("Codec: bad integer width");
+
+        uint64_t nan = (begin[0] & BLOCK_NAN) ? lowBits(width) : UINT64_MAX;
+        BitReader bits(begin + 1 + reader.offset(), size - 1 - reader.offset());
+        for (size_t i = 0; i < values; ++i) {
+            uint64_t code = width > 0 ? bits.read(width) : 0;
+            out[i] = code == nan ? std::nan("") : static_cast<double>(minimum + static_cast<int64_t>(code)) * scale + offset;
+        }
+        return values;
+    }
+
+    BitReader bits(begin + 1, size - 1);
+    uint64_t previous = bits.read(64);
+    std::memcpy(&out[0], &previous, sizeof(previous));
+
+    int windowLeading = 0, windowTrailing = 0;
+    for (size_t i = 1; i < values; ++i) {
+        if (bits.bit()) {
+            if (bits.bit()) {
+                windowLeading = static_cast<int>(bits.read(5));
+                int significant = static_cast<int>(bits.read(6)) + 1;
+                windowTrailing = 64 - windowLeading - significant;
+                if (windowTrailing < 0) throw std::runtime_error("Codec: bad XOR window");
+            }
+            previous ^= bits.read(64 - windowLeading - windowTrailing) << windowTrailing;
+        }
+        std::memcpy(&out[i], &previous, sizeof(previous));
+    }
+    return values;
+}
+
+double Codec::Column::at(size_t index) const {
+    if (index >= count) throw std::out_of_range("Column index out of range");
+    double values[BLOCK];
+    decode(index / BLOCK, values);
+    return values[index % BLOCK];
+}
+
+void Codec::Column::write(Writer& writer) const {
+    writer.putVarint(count);
+    writer.put(bitsOf(scale), 8);
+    writer.put(bitsOf(offset), 8);
+    writer.putVarint(data.size());
+    for (size_t i = 1; i < blocks.size(); ++i) writer.putVarint(blocks[i] - blocks[i - 1]);
+    writer.putBytes(data.data(), data.size());
+}
+
+Codec::Column Codec::Column::read(Reader& reader) {
+    Column column;
+    column.count = reader.getVarint();
+    uint64_t scale = reader.get(8), offset = reader.get(8);
+    std::memcpy(&column.scale, &scale, sizeof(scale));
+    std::memcpy(&column.offset, &offset, sizeof(offset));
+    size_t size = reader.getVarint();
+    size_t blocks = (column.count + BLOCK - 1) / BLOCK;
+    if (size > (column.count + 1) * (sizeof(double) + 2)) throw std::runtime_error("Codec: bad column size");
+
+    column.blocks.reserve(blocks);
+    uint64_t start = 0;
+    for (size_t i = 0; i < blocks; ++i) {
+        if (i > 0) start += reader.getVarint();
+        if (start >= size) throw std::runtime_error("Codec: bad column block");
+        column.blocks.push_back(static_cast<uint32_t>(start));
+    }
+    column.data.resize(size);
+    reader.getBytes(column.data.data(), size);
+    return column;
+}
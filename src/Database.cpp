@@ -0,0 +1,19 @@
+#include "Database.h"
+
+CAN::DatabaseStore::DatabaseStore(Database database) : current(std::make_shared<const Database>(std::move(database))) {}
+
+void CAN::DatabaseStore::publish(Database database) {
+    DatabaseSnapshot next = std::make_shared<const Database>(std::move(database));
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::atomic_store_explicit(&current, std::move(next), std::memory_order_release);
+    version.fetch_add(1, std::memory_order_release);
+}
+
+void CAN::DatabaseStore::update(const std::function<void(Database&)>& edit) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // Holding the lock keeps a concurrent edit from being lost between the copy and the swap
+    Database database = *snapshot();
+    edit(database);
+    std::atomic_store_explicit(&current, DatabaseSnapshot(std::make_shared<const Database>(std::move(database))), std::memory_order_release);
+    version.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,285 @@
+#include "Device.h"
+
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+size_t CAN::Device::receiveBatch(Frame* frames, size_t count, unsigned long timeout) {
+    if (count == 0 || !receive(frames[0], timeout)) return 0;
+
+    size_t received = 1;
+    while (received < count && receive(frames[received])) received++;
+    return received;
+}
+
+size_t CAN::Device::sendBatch(const Frame* frames, size_t count, int& error) {
+    for (size_t i = 0; i < count; ++i) {
+        error = send(frames[i]);
+        if (error != CANAL_ERROR_SUCCESS) return i;
+    }
+    error = CANAL_ERROR_SUCCESS;
+    return count;
+}
+
+#ifdef CANVIS_WITH_CANAL
+CAN::CanalDevice::CanalDevice(const std::string& config, unsigned long flags) {
+    handle = CanalOpen(config.c_str(), flags);
+    if (handle <= 0) throw std::runtime_error("CAN Channel not found! ERROR: " + std::to_string(handle));
+}
+
+CAN::CanalDevice::~CanalDevice() {
+    if (CanalClose(handle) != 0) {
+        std::cerr << "Failed to close the CAN channel!" << std::endl;
+    }
+}
+
+CANALMSG CAN::CanalDevice::toCanal(const Frame& frame) {
+    CANALMSG msg;
+    msg.flags = frame.flags;
+    msg.obid = frame.obid;
+    msg.id = frame.id;
+    msg.sizeData = frame.sizeData;
+    std::memcpy(msg.data, frame.data, CLASSIC_DATA_LENGTH);
+    msg.timestamp = static_cast<unsigned long>(frame.timestamp / 1000);
+    return msg;
+}
+
+bool CAN::CanalDevice::receive(Frame& frame) {
+    if (!CanalDataAvailable(handle)) return false;
+
+    CANALMSG msg;
+    if (CanalReceive(handle, &msg) != CANAL_ERROR_SUCCESS) return false;
+    frame = Frame(msg);
+    frame.timestamp = aligner.align(CLOCK, msg.timestamp, hostTime());
+    return true;
+}
+
+bool CAN::CanalDevice::receive(Frame& frame, unsigned long timeout) {
+    CANALMSG msg;
+    if (CanalBlockingReceive(handle, &msg, timeout) != CANAL_ERROR_SUCCESS) return false;
+    frame = Frame(msg);
+    frame.timestamp = aligner.align(CLOCK, msg.timestamp, hostTime());
+    return true;
+}
+
+int CAN::CanalDevice::send(const Frame& frame) {
+    if (frame.isFD() || frame.sizeData > CLASSIC_DATA_LENGTH) return CANAL_ERROR_NOT_SUPPORTED;
+
+    CANALMSG msg = toCanal(frame);
+    return CanalSend(handle, &msg);
+}
+
+int CAN::CanalDevice::send(const Frame& frame, unsigned long timeout) {
+    if (frame.isFD() || frame.sizeData > CLASSIC_DATA_LENGTH) return CANAL_ERROR_NOT_SUPPORTED;
+
+    CANALMSG msg = toCanal(frame);
+    return CanalBlockingSend(handle, &msg, timeout);
+}
+
+int CAN::CanalDevice::getStatistics(CANALSTATISTICS& statistics) {
+    return CanalGetStatistics(handle, &statistics);
+}
+
+int CAN::CanalDevice::setFilters(const std::vector<IDFilter>& filters) {
+    unsigned long code = 0, mask = 0;
+    if (!filters.empty()) {
+        // Only bits that are significant and equal in every filter stay significant
+        code = filters[0].id;
+        mask = filters[0].mask;
+        for (const IDFilter& filter : filters) mask &= filter.mask & ~(filter.id ^ code);
+        code &= mask;
+    }
+
+    int error = CanalSetFilter(handle, code);
+    if (error != CANAL_ERROR_SUCCESS) return error;
+    return CanalSetMask(handle, mask);
+}
+#endif
+
+#ifdef __linux__
+CAN::SocketCANDevice::SocketCANDevice(const std::string& interface) {
+    socketFD = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (socketFD < 0) throw std::runtime_error("Could not open CAN socket");
+
+    int enable = 1;
+    setsockopt(socketFD, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+    // Error frames are only delivered for the classes in the error filter, the default is none
+    can_err_mask_t errors = CAN_ERR_MASK;
+    setsockopt(socketFD, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &errors, sizeof(errors));
+
+    ifreq ifr{};
+    std::strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    if (ioctl(socketFD, SIOCGIFINDEX, &ifr) < 0) {
+        close(socketFD);
+        throw std::runtime_error("CAN interface not found: " + interface);
+    }
+
+    sockaddr_can addr{};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(socketFD, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(socketFD);
+        throw std::runtime_error("Could not bind CAN interface: " + interface);
+    }
+}
+
+CAN::SocketCANDevice::~SocketCANDevice() {
+    close(socketFD);
+}
+
+static bool toFrame(const canfd_frame& raw, size_t nBytes, CAN::Frame& frame) {
+    if (nBytes != CAN_MTU && nBytes != CANFD_MTU) return false;
+
+    frame.flags = 0;
+    if (raw.can_id & CAN_EFF_FLAG) frame.flags |= MSG_FLAG_EXTENDED;
+    if (raw.can_id & CAN_RTR_FLAG) frame.flags |= MSG_FLAG_RTR;
+    if (raw.can_id & CAN_ERR_FLAG) frame.flags |= MSG_FLAG_ERROR;
+    if (nBytes == CANFD_MTU) {
+        frame.flags |= MSG_FLAG_FD;
+        if (raw.flags & CANFD_BRS) frame.flags |= MSG_FLAG_BRS;
+        if (raw.flags & CANFD_ESI) frame.flags |= MSG_FLAG_ESI;
+    }
+
+    frame.obid = 0;
+    // Error frames carry the error class in the id
+    if (raw.can_id & CAN_ERR_FLAG) frame.id = raw.can_id & CAN_ERR_MASK;
+    else frame.id = raw.can_id & (raw.can_id & CAN_EFF_FLAG ? CAN_EFF_MASK : CAN_SFF_MASK);
+    frame.sizeData = std::min<unsigned char>(raw.len, MAX_DATA_LENGTH);
+    std::memcpy(frame.data, raw.data, frame.sizeData);
+    return true;
+}
+
+static bool readFrame(int socketFD, CAN::Frame& frame, int flags) {
+    canfd_frame raw;
+    ssize_t nBytes = recv(socketFD, &raw, sizeof(raw), flags);
+    if (nBytes < 0 || !toFrame(raw, static_cast<size_t>(nBytes), frame)) return false;
+
+    frame.timestamp = CAN::hostTime();
+    return true;
+}
+
+bool CAN::SocketCANDevice::receive(Frame& frame) {
+    return readFrame(socketFD, frame, MSG_DONTWAIT);
+}
+
+size_t CAN::SocketCANDevice::receiveBatch(Frame* frames, size_t count, unsigned long timeout) {
+    const size_t BATCH = 64;
+    pollfd pfd = {socketFD, POLLIN, 0};
+    if (count == 0 || poll(&pfd, 1, static_cast<int>(timeout)) <= 0) return 0;
+
+    // One recvmmsg call per batch of up to 64 frames
+    canfd_frame raws[BATCH];
+    iovec iovs[BATCH];
+    mmsghdr messages[BATCH];
+    size_t n = std::min(BATCH, count);
+    for (size_t i = 0; i < n; ++i) {
+        iovs[i] = {&raws[i], sizeof(raws[i])};
+        messages[i] = {};
+        messages[i].msg_hdr.msg_iov = &iovs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int result = recvmmsg(socketFD, messages, static_cast<unsigned int>(n), MSG_DONTWAIT, nullptr);
+    if (result <= 0) return 0;
+
+    uint64_t timestamp = CAN::hostTime();
+    size_t received = 0;
+    for (int i = 0; i < result; ++i) {
+        if (toFrame(raws[i], messages[i].msg_len, frames[received])) {
+            frames[received++].timestamp = timestamp;
+        }
+    }
+    return received;
+}
+
+bool CAN::SocketCANDevice::receive(Frame& frame, unsigned long timeout) {
+    pollfd pfd = {socketFD, POLLIN, 0};
+    if (poll(&pfd, 1, static_cast<int>(timeout)) <= 0) return false;
+    return readFrame(socketFD, frame, MSG_DONTWAIT);
+}
+
+static canfd_frame toRaw(const CAN::Frame& frame) {
+    canfd_frame raw{};
+    raw.can_id = frame.id;
+    if (frame.flags & MSG_FLAG_EXTENDED) raw.can_id |= CAN_EFF_FLAG;
+    if (frame.flags & MSG_FLAG_RTR) raw.can_id |= CAN_RTR_FLAG;
+    raw.len = frame.sizeData;
+    if (frame.flags & MSG_FLAG_BRS) raw.flags |= CANFD_BRS;
+    std::memcpy(raw.data, frame.data, frame.sizeData);
+    return raw;
+}
+
+int CAN::SocketCANDevice::send(const Frame& frame) {
+    canfd_frame raw = toRaw(frame);
+
+    size_t mtu = frame.isFD() ? CANFD_MTU : CAN_MTU;
+    if (write(socketFD, &raw, mtu) != static_cast<ssize_t>(mtu)) {
+        return errno == ENOBUFS || errno == EAGAIN ? CANAL_ERROR_TRM_FULL : CANAL_ERROR_COMMUNICATION;
+    }
+    return CANAL_ERROR_SUCCESS;
+}
+
+size_t CAN::SocketCANDevice::sendBatch(const Frame* frames, size_t count, int& error) {
+    // One sendmmsg call per batch of up to 64 frames
+    const size_t BATCH = 64;
+    canfd_frame raws[BATCH];
+    iovec iovs[BATCH];
+    mmsghdr messages[BATCH];
+
+    size_t sent = 0;
+    while (sent < count) {
+        size_t n = std::min(BATCH, count - sent);
+        for (size_t i = 0; i < n; ++i) {
+            raws[i] = toRaw(frames[sent + i]);
+            iovs[i] = {&raws[i], frames[sent + i].isFD() ? CANFD_MTU : CAN_MTU};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &iovs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int result = sendmmsg(socketFD, messages, static_cast<unsigned int>(n), MSG_DONTWAIT);
+        if (result < 0) {
+            error = errno == ENOBUFS || errno == EAGAIN ? CANAL_ERROR_TRM_FULL : CANAL_ERROR_COMMUNICATION;
+            return sent;
+        }
+        sent += result;
+        if (static_cast<size_t>(result) < n) {
+            error = CANAL_ERROR_TRM_FULL;
+            return sent;
+        }
+    }
+    error = CANAL_ERROR_SUCCESS;
+    return sent;
+}
+
+int CAN::SocketCANDevice::send(const Frame& frame, unsigned long timeout) {
+    pollfd pfd = {socketFD, POLLOUT, 0};
+    if (poll(&pfd, 1, static_cast<int>(timeout)) <= 0) return CANAL_ERROR_TIMEOUT;
+    return send(frame);
+}
+
+int CAN::SocketCANDevice::setFilters(const std::vector<IDFilter>& filters) {
+    // The masks leave out CAN_EFF_FLAG, so standard and extended ids both pass
+    std::vector<can_filter> raw;
+    for (const IDFilter& filter : filters) raw.push_back({static_cast<canid_t>(filter.id), static_cast<canid_t>(filter.mask)});
+    if (raw.empty()) raw.push_back({0, 0});
+
+    if (setsockopt(socketFD, SOL_CAN_RAW, CAN_RAW_FILTER, raw.data(), static_cast<socklen_t>(raw.size() * sizeof(can_filter))) < 0) {
+        return CANAL_ERROR_GENERIC;
+    }
+    return CANAL_ERROR_SUCCESS;
+}
+#endif
@@ -0,0 +1,82 @@
+#include "Expression.h"
+
+#include <cctype>
+#include <stdexcept>
+
+double CAN::toDouble(const Signal& signal) {
+    return std::visit([](auto value) { return static_cast<double>(value); }, signal);
+}
+
+std::vector<CAN::SignalBinding> CAN::bindSignal(const std::string& name, const Database& database) {
+    std::string messageName, signalName = name;
+    size_t dot = name.find('.');
+    if (dot != std::string::npos) {
+        messageName = name.substr(0, dot);
+        signalName = name.substr(dot + 1);
+    }
+
+    std::vector<SignalBinding> bindings;
+    for (const auto& [id, description] : database) {
+        if (!messageName.empty() && description.name != messageName) continue;
+        for (const SignalDescription& sigDes : description.signals) {
+            if (sigDes.name != signalName) continue;
+
+            SignalBinding binding{description.id, sigDes, false, SignalDescription()};
+            for (const SignalDescription& candidate : description.signals) {
+                if (candidate.multiplexer && sigDes.multiplexValue != MUX_NONE) {
+                    binding.multiplexed = true;
+                    binding.multiplexer = candidate;
+                }
+            }
+            bindings.push_back(binding);
+        }
+    }
+    return bindings;
+}
+
+bool CAN::SignalBinding::decode(const uint8_t* data, size_t size, double& value) const {
+    if (multiplexed && toDouble(decodeSignal(multiplexer, data, size)) != signal.multiplexValue) return false;
+    value = toDouble(decodeSignal(signal, data, size));
+    return true;
+}
+
+void CAN::ExpressionLexer::fail(const std::string& message) const {
+    throw std::runtime_error(kind + ": " + message + " at position " + std::to_string(position));
+}
+
+void CAN::ExpressionLexer::skipSpace() {
+    while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) position++;
+}
+
+bool CAN::ExpressionLexer::accept(const char* token) {
+    skipSpace();
+    size_t length = std::char_traits<char>::length(token);
+    if (text.compare(position, length, token) != 0) return false;
+    if (std::isalpha(static_cast<unsigned char>(token[0])) && position + length < text.size()) {
+        char next = text[position + length];
+        if (std::isalnum(static_cast<unsigned char>(next)) || next == '_') return false;
+    }
+    position += length;
+    return true;
+}
+
+void CAN::ExpressionLexer::expect(const char* token) {
+    if (!accept(token)) fail(std::string("expected '") + token + "'");
+}
+
+std::string CAN::ExpressionLexer::identifier() {
+    skipSpace();
+    size_t start = position;
+    if (position < text.size() && (std::isalpha(static_cast<unsigned char>(text[position])) || text[position] == '_')) {
+        while (position < text.size() && (std::isalnum(static_cast<unsigned char>(text[position])) || text[position] == '_' ||
+                                          (text[position] == '.' && text.compare(position, 2, "..") != 0))) {
+            position++;
+        }
+    }
+    return text.substr(start, position - start);
+}
+
+void CAN::ExpressionLexer::expectEnd() {
+    skipSpace();
+    if (position != text.size()) fail("unexpected input");
+}
@@ -0,0 +1,316 @@
+#include "Filter.h"
+
+#include <memory>
+#include <cctype>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+#define ID_MASK 0x1FFFFFFFUL
+
+struct CAN::Filter::Node {
+    enum Kind { AND, OR, NOT, LEAF } kind;
+    std::unique_ptr<Node> left;
+    std::unique_ptr<Node> right;
+    Instruction test;
+};
+
+// Recursive descent over the expression, builds the tree that is then flattened into the program
+class CAN::Filter::Parser : private ExpressionLexer {
+private:
+    const Database* database;
+    Filter& filter;
+
+    double number() {
+        skipSpace();
+        size_t start = position;
+        bool negative = position < text.size() && text[position] == '-';
+        if (negative) position++;
+
+        if (text.compare(position, 2, "0x") == 0 || text.compare(position, 2, "0X") == 0) {
+            position += 2;
+            size_t digits = position;
+            while (position < text.size() && std::isxdigit(static_cast<unsigned char>(text[position]))) position++;
+            if (position == digits) fail("expected hex digits");
+
+            std::string token = text.substr(digits, position - digits);
+            char* end = nullptr;
+            errno = 0;
+            unsigned long long value = std::strtoull(token.c_str(), &end, 16);
+            if (errno == ERANGE) fail("number out of range");
+            return negative ? -static_cast<double>(value) : static_cast<double>(value);
+        }
+
+        // A single '.' is a decimal point, ".." starts the upper bound of a range
+        while (position < text.size() && (std::isdigit(static_cast<unsigned char>(text[position])) ||
+                                          (text[position] == '.' && text.compare(position, 2, "..") != 0))) {
+            position++;
+        }
+
+        std::string token = text.substr(start, position - start);
+        char* end = nullptr;
+        errno = 0;
+        double value = std::strtod(token.c_str(), &end);
+        if (token.empty() || end != token.c_str() + token.size()) {
+            position = start;
+            fail("expected a number");
+        }
+        if (errno == ERANGE) fail("number out of range");
+        return value;
+    }
+
+    uint32_t signal(const std::string& name) {
+        if (!database) fail("signal '" + name + "' needs a database");
+        std::vector<SignalBinding> bindings = bindSignal(name, *database);
+        if (bindings.empty()) fail("unknown signal '" + name + "'");
+
+        filter.signals.push_back(std::move(bindings));
+        return static_cast<uint32_t>(filter.signals.size() - 1);
+    }
+
+    std::unique_ptr<Node> predicate() {
+        static const std::pair<const char*, unsigned long> flags[] = {
+            {"ext", MSG_FLAG_EXTENDED}, {"rtr", MSG_FLAG_RTR}, {"fd", MSG_FLAG_FD},
+            {"brs", MSG_FLAG_BRS}, {"esi", MSG_FLAG_ESI}, {"error", MSG_FLAG_ERROR},
+        };
+
+        auto node = std::make_unique<Node>();
+        node->kind = Node::LEAF;
+        Instruction& test = node->test;
+
+        std::string name = identifier();
+        if (name.empty()) fail("expected a predicate");
+
+        for (const auto& [flag, bit] : flags) {
+            if (name == flag) {
+                test.field = FIELD_FLAGS;
+                test.mask = bit;
+                test.compare = NE;
+                return node;
+            }
+        }
+
+        if (name == "id") test.field = FIELD_ID;
+        else if (name == "dlc") test.field = FIELD_DLC;
+        else if (name == "channel") test.field = FIELD_CHANNEL;
+        else if (name == "data") {
+            test.field = FIELD_DATA;
+            expect("[");
+            double index = number();
+            if (index < 0 || index >= MAX_DATA_LENGTH) fail("data index out of range");
+            test.index = static_cast<uint32_t>(index);
+            expect("]");
+        } else {
+            test.field = FIELD_SIGNAL;
+            test.index = signal(name);
+        }
+
+        skipSpace();
+        if (text.compare(position, 2, "&&") != 0 && accept("&")) {
+            if (test.field == FIELD_SIGNAL) fail("masks only apply to integer fields");
+            double mask = number();
+            if (mask < 0 || mask >= 0x1p64) fail("mask out of range");
+            test.mask = static_cast<uint64_t>(mask);
+        }
+
+        if (accept("in")) {
+            test.compare = RANGE;
+            test.low = number();
+            expect("..");
+            test.high = number();
+            return node;
+        }
+
+        if (accept("==")) test.compare = EQ;
+        else if (accept("!=")) test.compare = NE;
+        else if (accept("<=")) test.compare = LE;
+        else if (accept(">=")) test.compare = GE;
+        else if (accept("<")) test.compare = LT;
+        else if (accept(">")) test.compare = GT;
+        else fail("expected a comparison");
+        test.low = number();
+        return node;
+    }
+
+    std::unique_ptr<Node> unary() {
+        if (accept("!")) {
+            auto node = std::make_unique<Node>();
+            node->kind = Node::NOT;
+            node->left = unary();
+            return node;
+        }
+        if (accept("(")) {
+            auto node = expression();
+            expect(")");
+            return node;
+        }
+        return predicate();
+    }
+
+    std::unique_ptr<Node> binary(Node::Kind kind, const char* token, std::unique_ptr<Node> (Parser::*operand)()) {
+        auto node = (this->*operand)();
+        while (accept(token)) {
+            auto parent = std::make_unique<Node>();
+            parent->kind = kind;
+            parent->left = std::move(node);
+            parent->right = (this->*operand)();
+            node = std::move(parent);
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> conjunction() {
+        return binary(Node::AND, "&&", &Parser::unary);
+    }
+
+public:
+    Parser(const std::string& text, const Database* database, Filter& filter) : ExpressionLexer(text, "Filter"), database(database), filter(filter) {}
+
+    std::unique_ptr<Node> expression() {
+        return binary(Node::OR, "||", &Parser::conjunction);
+    }
+
+    std::unique_ptr<Node> parse() {
+        auto node = expression();
+        expectEnd();
+        return node;
+    }
+};
+
+void CAN::Filter::compile(const Node& node) {
+    switch (node.kind) {
+    case Node::LEAF:
+        program.push_back(node.test);
+        break;
+    case Node::NOT:
+        compile(*node.left);
+        program.push_back(Instruction{NOT});
+        break;
+    case Node::AND:
+    case Node::OR: {
+        // Short circuit: skip the right side once the left side decides the result
+        compile(*node.left);
+        size_t jump = program.size();
+        program.push_back(Instruction{node.kind == Node::AND ? JUMP_FALSE : JUMP_TRUE});
+        compile(*node.right);
+        program[jump].index = static_cast<uint32_t>(program.size());
+        break;
+    }
+    }
+}
+
+std::optional<std::vector<CAN::IDFilter>> CAN::Filter::pushDown(const Node& node) {
+    switch (node.kind) {
+    case Node::LEAF: {
+        const Instruction& test = node.test;
+        if (test.field != FIELD_ID) return std::nullopt;
+
+        unsigned long low = static_cast<unsigned long>(test.low) & ID_MASK;
+        if (test.compare == EQ) {
+            unsigned long mask = test.mask ? static_cast<unsigned long>(test.mask) & ID_MASK : ID_MASK;
+            return std::vector<IDFilter>{{low & mask, mask}};
+        }
+        if (test.compare == RANGE && !test.mask && test.low <= test.high) {
+            // Common prefix of both bounds
+            unsigned long high = static_cast<unsigned long>(test.high) & ID_MASK;
+            unsigned long mask = ID_MASK;
+            while ((low & mask) != (high & mask)) mask = (mask << 1) & ID_MASK;
+            return std::vector<IDFilter>{{low & mask, mask}};
+        }
+        return std::nullopt;
+    }
+    case Node::AND: {
+        auto left = pushDown(*node.left);
+        return left ? left : pushDown(*node.right);
+    }
+    case Node::OR: {
+        auto left = pushDown(*node.left);
+        auto right = pushDown(*node.right);
+        if (!left || !right) return std::nullopt;
+        left->insert(left->end(), right->begin(), right->end());
+        return left;
+    }
+    case Node::NOT:
+        return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+CAN::Filter::Filter(const std::string& expression, const Database* database) : expression(expression) {
+    bool blank = true;
+    for (char c : expression) blank = blank && std::isspace(static_cast<unsigned char>(c));
+    if (blank) return;
+
+    std::unique_ptr<Node> root = Parser(expression, database, *this).parse();
+    compile(*root);
+    if (auto filters = pushDown(*root)) idFilters = *filters;
+}
+
+bool CAN::Filter::test(const Instruction& instruction, const Frame& frame) const {
+    double value;
+    switch (instruction.field) {
+    case FIELD_ID:
+        value = static_cast<double>(instruction.mask ? frame.id & instruction.mask : frame.id);
+        break;
+    case FIELD_DLC:
+        value = static_cast<double>(instruction.mask ? frame.sizeData & instruction.mask : frame.sizeData);
+        break;
+    case FIELD_CHANNEL:
+        value = static_cast<double>(instruction.mask ? frame.obid & instruction.mask : frame.obid);
+        break;
+    case FIELD_FLAGS:
+        value = static_cast<double>(frame.flags & instruction.mask);
+        break;
+    case FIELD_DATA:
+        if (instruction.index >= frame.sizeData) return false;
+        value = static_cast<double>(instruction.mask ? frame.data[instruction.index] & instruction.mask : frame.data[instruction.index]);
+        break;
+    case FIELD_SIGNAL: {
+        const SignalBinding* binding = nullptr;
+        for (const SignalBinding& candidate : signals[instruction.index]) {
+            if (candidate.id == frame.id) binding = &candidate;
+        }
+        if (!binding || (frame.flags & (MSG_FLAG_RTR | MSG_FLAG_ERROR))) return false;
+        if (!binding->decode(frame.data, std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH), value)) return false;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    switch (instruction.compare) {
+    case EQ: return value == instruction.low;
+    case NE: return value != instruction.low;
+    case LT: return value < instruction.low;
+    case LE: return value <= instruction.low;
+    case GT: return value > instruction.low;
+    case GE: return value >= instruction.low;
+    case RANGE: return value >= instruction.low && value <= instruction.high;
+    }
+    return false;
+}
+
+bool CAN::Filter::matches(const Frame& frame) const {
+    bool result = true;
+    size_t pc = 0;
+    while (pc < program.size()) {
+        const Instruction& instruction = program[pc];
+        switch (instruction.op) {
+        case TEST:
+            result = test(instruction, frame);
+            pc++;
+            break;
+        case NOT:
+            result = !result;
+            pc++;
+            break;
+        case JUMP_FALSE:
+            pc = result ? pc + 1 : instruction.index;
+            break;
+        case JUMP_TRUE:
+            pc = result ? instruction.index : pc + 1;
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,141 @@
+#include "Log.h"
+
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <algorithm>
+
+static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+static void putLE(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i, value >>= 8) out[i] = static_cast<uint8_t>(value);
+}
+
+static uint64_t getLE(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | in[i];
+    return value;
+}
+
+CAN::LogWriter::LogWriter(const std::string& basename, uint64_t rotateSize, unsigned long rotateTime)
+    : basename(basename), rotateSize(rotateSize), rotateTime(rotateTime) {
+    buffer.reserve(BUFFER_SIZE);
+    open();
+}
+
+CAN::LogWriter::~LogWriter() {
+    // Errors surface from flush(), a destructor has nowhere to report them
+    if (!file) return;
+    writeBuffer();
+    std::fclose(file);
+}
+
+void CAN::LogWriter::open() {
+    // <basename>_<YYYYMMDD_HHMMSS>_<index>.cvl
+    std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y%m%d_%H%M%S", std::localtime(&now));
+    filename = basename + "_" + date + "_" + std::to_string(fileIndex++) + ".cvl";
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) throw std::runtime_error("Could not open log file: " + filename);
+
+    uint8_t header[LOG_HEADER_SIZE] = {};
+    std::memcpy(header, LOG_MAGIC, 8);
+    putLE(header + 8, LOG_VERSION, 2);
+    if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        std::fclose(file);
+        file = nullptr;
+        throw std::runtime_error("Could not write log file: " + filename);
+    }
+
+    fileBytes = LOG_HEADER_SIZE;
+    opened = std::chrono::steady_clock::now();
+}
+
+void CAN::LogWriter::close() {
+    if (!file) return;
+    bool written = writeBuffer();
+    written = std::fclose(file) == 0 && written;
+    file = nullptr;
+    if (!written) throw std::runtime_error("Could not write log file: " + filename);
+}
+
+void CAN::LogWriter::write(const Frame& frame) {
+    write(&frame, 1);
+}
+
+void CAN::LogWriter::write(const Frame* frames, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const Frame& frame = frames[i];
+        size_t length = std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH);
+
+        uint8_t record[LOG_RECORD_SIZE] = {};
+        putLE(record, frame.timestamp, 8);
+        putLE(record + 8, frame.id, 4);
+        putLE(record + 12, frame.flags, 4);
+        record[16] = static_cast<uint8_t>(frame.obid);
+        record[17] = static_cast<uint8_t>(length);
+
+        if (buffer.size() + LOG_RECORD_SIZE + length > BUFFER_SIZE) flush();
+        buffer.insert(buffer.end(), record, record + LOG_RECORD_SIZE);
+        buffer.insert(buffer.end(), frame.data, frame.data + length);
+
+        fileBytes += LOG_RECORD_SIZE + length;
+        totalBytes += LOG_RECORD_SIZE + length;
+    }
+    totalFrames += count;
+
+    bool sizeExceeded = rotateSize > 0 && fileBytes >= rotateSize;
+    bool timeExceeded = rotateTime > 0 && std::chrono::steady_clock::now() - opened >= std::chrono::seconds(rotateTime);
+    if (sizeExceeded || timeExceeded) {
+        close();
+        open();
+    }
+}
+
+bool CAN::LogWriter::writeBuffer() {
+    if (buffer.empty()) return true;
+    bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    written = std::fflush(file) == 0 && written;
+    buffer.clear();
+    return written;
+}
+
+void CAN::LogWriter::flush() {
+    if (!file) return;
+    if (!writeBuffer()) throw std::runtime_error("Could not write log file: " + filename);
+}
+
+CAN::LogReader::LogReader(const std::string& filename) {
+    file = std::fopen(filename.c_str(), "rb");
+    if (!file) throw std::runtime_error("Could not open log file: " + filename);
+
+    uint8_t header[LOG_HEADER_SIZE];
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header) || std::memcmp(header, LOG_MAGIC, 8) != 0) {
+        std::fclose(file);
+        throw std::runtime_error("Not a CANVis log file: " + filename);
+    }
+    version = static_cast<unsigned>(getLE(header + 8, 2));
+    if (version > LOG_VERSION) {
+        std::fclose(file);
+        throw std::runtime_error("Unsupported log version: " + filename);
+    }
+}
+
+CAN::LogReader::~LogReader() {
+    std::fclose(file);
+}
+
+bool CAN::LogReader::read(Frame& frame) {
+    uint8_t record[LOG_RECORD_SIZE];
+    if (std::fread(record, 1, sizeof(record), file) != sizeof(record)) return false;
+
+    frame.timestamp = getLE(record, 8);
+    if (version < 2) frame.timestamp *= 1000;
+    frame.id = static_cast<unsigned long>(getLE(record + 8, 4));
+    frame.flags = static_cast<unsigned long>(getLE(record + 12, 4));
+    frame.obid = record[16];
+    frame.sizeData = std::min<unsigned char>(record[17], MAX_DATA_LENGTH);
+    return std::fread(frame.data, 1, frame.sizeData, file) == frame.sizeData;
+}
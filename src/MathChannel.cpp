@@ -0,0 +1,322 @@
+#include "MathChannel.h"
+
+#include <map>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+
+// Recursive descent over the expression, emits the program in postfix order as it goes
+class CAN::MathChannel::Parser : private ExpressionLexer {
+private:
+    const Database* database;
+    MathChannel& channel;
+    std::map<std::string, uint32_t> slots; // By signal name as written
+
+    void emit(Op op, uint32_t index = 0, double value = 0) {
+        channel.program.push_back(Instruction{op, index, value});
+    }
+
+    uint32_t signal(const std::string& name) {
+        auto known = slots.find(name);
+        if (known != slots.end()) return known->second;
+        if (!database) fail("signal '" + name + "' needs a database");
+        std::vector<SignalBinding> bindings = bindSignal(name, *database);
+        if (bindings.empty()) fail("unknown signal '" + name + "'");
+
+        uint32_t slot = static_cast<uint32_t>(channel.slots++);
+        for (const SignalBinding& binding : bindings) channel.inputs.push_back(Input{binding, slot});
+        slots[name] = slot;
+        return slot;
+    }
+
+    double number() {
+        skipSpace();
+        const char* start = text.c_str() + position;
+        char* end = nullptr;
+        double value = std::strtod(start, &end);
+        if (end == start) fail("expected a number");
+        position += end - start;
+        return value;
+    }
+
+    void call(const std::string& function) {
+        static const std::pair<const char*, Op> oneArgument[] = {{"abs", ABS}, {"deriv", DERIV}, {"integ", INTEG}};
+        static const std::pair<const char*, Op> twoArguments[] = {{"min", MIN}, {"max", MAX}};
+
+        for (const auto& [functionName, op] : oneArgument) {
+            if (function != functionName) continue;
+            expression();
+            expect(")");
+            uint32_t state = 0;
+            if (op != ABS) {
+                state = static_cast<uint32_t>(channel.states.size());
+                channel.states.emplace_back();
+            }
+            emit(op, state);
+            return;
+        }
+        for (const auto& [functionName, op] : twoArguments) {
+            if (function != functionName) continue;
+            expression();
+            expect(",");
+            expression();
+            expect(")");
+            emit(op);
+            return;
+        }
+        if (function == "avg") {
+            expression();
+            expect(",");
+            double samples = number();
+            if (samples < 1 || samples > 1e6 || samples != std::floor(samples)) fail("avg takes 1 to 1000000 samples");
+            expect(")");
+            channel.states.emplace_back();
+            channel.states.back().window.resize(static_cast<size_t>(samples));
+            emit(AVG, static_cast<uint32_t>(channel.states.size() - 1), samples);
+            return;
+        }
+        fail("unknown function '" + function + "'");
+    }
+
+    void primary() {
+        if (accept("(")) {
+            expression();
+            expect(")");
+            return;
+        }
+
+        skipSpace();
+        if (position < text.size() && (std::isdigit(static_cast<unsigned char>(text[position])) || text[position] == '.')) {
+            emit(CONSTANT, 0, number());
+            return;
+        }
+
+        std::string name = identifier();
+        if (name.empty()) fail("expected a signal, number or function");
+        if (accept("(")) call(name);
+        else emit(INPUT, signal(name));
+    }
+
+    void unary() {
+        if (accept("-")) {
+            unary();
+            emit(NEG);
+            return;
+        }
+        primary();
+    }
+
+    void term() {
+        unary();
+        while (true) {
+            if (accept("*")) {
+                unary();
+                emit(MUL);
+            } else if (accept("/")) {
+                unary();
+                emit(DIV);
+            } else {
+                return;
+            }
+        }
+    }
+
+public:
+    Parser(const std::string& text, const Database* database, MathChannel& channel)
+        : ExpressionLexer(text, "Math channel"), database(database), channel(channel) {}
+
+    void expression() {
+        term();
+        while (true) {
+            if (accept("+")) {
+                term();
+                emit(ADD);
+            } else if (accept("-")) {
+                term();
+                emit(SUB);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void parse() {
+        expression();
+        expectEnd();
+    }
+};
+
+CAN::MathChannel::MathChannel(const std::string& name, const std::string& expression, const Database* database)
+    : name(name), expression(expression) {
+    Parser(expression, database, *this).parse();
+    if (slots == 0) throw std::runtime_error("Math channel: the expression has no signal");
+
+    size_t top = 0;
+    for (const Instruction& instruction : program) {
+        if (instruction.op == INPUT || instruction.op == CONSTANT) depth = std::max(depth, ++top);
+        else if (binary(instruction.op)) top--;
+    }
+    stack.resize(depth);
+    batchInputs.resize(slots);
+    clear();
+}
+
+void CAN::MathChannel::add(const Frame* frames, size_t count, uint64_t sequence) {
+    // Gather the held inputs of every sample first, so the program runs once over the whole batch
+    batchTimes.clear();
+    for (std::vector<double>& column : batchInputs) column.clear();
+    for (size_t i = 0; i < count; ++i) {
+        const Frame& frame = frames[i];
+        if (frame.flags & (MSG_FLAG_RTR | MSG_FLAG_ERROR)) continue;
+
+        bool updated = false;
+        size_t size = std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH);
+        for (const Input& input : inputs) {
+            if (input.binding.id != frame.id || !input.binding.decode(frame.data, size, held[input.slot])) continue;
+            if (!seen[input.slot]) {
+                seen[input.slot] = true;
+                missing--;
+            }
+            updated = true;
+        }
+        if (!updated || missing > 0) continue;
+
+        // The previous sample is in this batch or, for the first of the batch, in an earlier one
+        if (!batchTimes.empty() ? frame.timestamp < batchTimes.back() : !times.empty() && frame.timestamp < times.back()) sorted = false;
+        batchTimes.push_back(frame.timestamp);
+        sequences.push_back(sequence + i);
+        for (size_t slot = 0; slot < slots; ++slot) batchInputs[slot].push_back(held[slot]);
+    }
+
+    if (batchTimes.empty()) return;
+    evaluate(batchTimes.size());
+    times.insert(times.end(), batchTimes.begin(), batchTimes.end());
+    values.insert(values.end(), stack[0].begin(), stack[0].begin() + batchTimes.size());
+}
+
+void CAN::MathChannel::evaluate(size_t rows) {
+    // Every instruction is a loop over the rows, arithmetic compiles to vector code
+    const uint64_t* t = batchTimes.data();
+    size_t top = 0;
+    for (const Instruction& instruction : program) {
+        double* a = top > 0 ? stack[top - 1].data() : nullptr;
+        const double* b = top > 0 ? stack[top - 1].data() : nullptr;
+        if (binary(instruction.op)) {
+            a = stack[top - 2].data();
+            top--;
+        }
+
+        switch (instruction.op) {
+        case INPUT:
+            stack[top++].assign(batchInputs[instruction.index].begin(), batchInputs[instruction.index].end());
+            break;
+        case CONSTANT:
+            stack[top++].assign(rows, instruction.value);
+            break;
+        case ADD:
+            for (size_t i = 0; i < rows; ++i) a[i] += b[i];
+            break;
+        case SUB:
+            for (size_t i = 0; i < rows; ++i) a[i] -= b[i];
+            break;
+        case MUL:
+            for (size_t i = 0; i < rows; ++i) a[i] *= b[i];
+            break;
+        case DIV:
+            for (size_t i = 0; i < rows; ++i) a[i] /= b[i];
+            break;
+        case MIN:
+            for (size_t i = 0; i < rows; ++i) a[i] = std::min(a[i], b[i]);
+            break;
+        case MAX:
+            for (size_t i = 0; i < rows; ++i) a[i] = std::max(a[i], b[i]);
+            break;
+        case NEG:
+            for (size_t i = 0; i < rows; ++i) a[i] = -a[i];
+            break;
+        case ABS:
+            for (size_t i = 0; i < rows; ++i) a[i] = std::fabs(a[i]);
+            break;
+        case AVG: {
+            State& state = states[instruction.index];
+            size_t window = state.window.size();
+            for (size_t i = 0; i < rows; ++i) {
+                state.sum += a[i] - state.window[state.next];
+                state.window[state.next] = a[i];
+                state.count = std::min(state.count + 1, window);
+                if (++state.next == window) {
+                    // Summing the ring again on every lap keeps rounding and NaN from adding up
+                    state.next = 0;
+                    state.sum = 0;
+                    for (double value : state.window) state.sum += value;
+                }
+                a[i] = state.sum / static_cast<double>(state.count);
+            }
+            break;
+        }
+        case DERIV: {
+            State& state = states[instruction.index];
+            for (size_t i = 0; i < rows; ++i) {
+                // Samples at the same time keep the last slope, NaN until there is one
+                double dt = static_cast<double>(static_cast<int64_t>(t[i] - state.time)) / 1e9;
+                if (state.started && dt != 0) {
+                    state.result = (a[i] - state.last) / dt;
+                    state.count = 1;
+                }
+                state.last = a[i];
+                state.time = t[i];
+                state.started = true;
+                a[i] = state.count ? state.result : std::nan("");
+            }
+            break;
+        }
+        case INTEG: {
+            State& state = states[instruction.index];
+            for (size_t i = 0; i < rows; ++i) {
+                if (state.started) state.result += (a[i] + state.last) / 2 * (static_cast<double>(static_cast<int64_t>(t[i] - state.time)) / 1e9);
+                state.last = a[i];
+                state.time = t[i];
+                state.started = true;
+                a[i] = state.result;
+            }
+            break;
+        }
+        }
+    }
+}
+
+void CAN::MathChannel::trim(uint64_t sequence) {
+    size_t stale = sizeAt(sequence);
+    times.erase(times.begin(), times.begin() + stale);
+    sequences.erase(sequences.begin(), sequences.begin() + stale);
+    values.erase(values.begin(), values.begin() + stale);
+}
+
+void CAN::MathChannel::clear() {
+    times.clear();
+    sequences.clear();
+    values.clear();
+    sorted = true;
+
+    held.assign(slots, 0);
+    seen.assign(slots, false);
+    missing = slots;
+    for (State& state : states) {
+        size_t window = state.window.size();
+        state = State();
+        state.window.assign(window, 0);
+    }
+}
+
+size_t CAN::MathChannel::sizeAt(uint64_t sequence) const {
+    return std::lower_bound(sequences.begin(), sequences.end(), sequence) - sequences.begin();
+}
+
+CAN::MathChannel::Span CAN::MathChannel::range(uint64_t t0, uint64_t t1) const {
+    if (!sorted) return Span{0, times.size()};
+    Span span;
+    span.begin = std::lower_bound(times.begin(), times.end(), t0) - times.begin();
+    span.end = std::max(span.begin, static_cast<size_t>(std::upper_bound(times.begin(), times.end(), t1) - times.begin()));
+    return span;
+}
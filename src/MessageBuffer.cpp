@@ -0,0 +1,727 @@
+#include "MessageBuffer.h"
+#include "Codec.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+// First index in [0, count) for which predicate is false, predicate has to be true for a prefix
+template <typename Predicate>
+static size_t partition(size_t count, Predicate predicate) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (predicate(middle)) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Rows of a segment (rows[i] for i < count) from the first at or after t0, and one past the last at or before t1
+template <typename Row>
+static void rowRange(const std::vector<uint64_t>& timestamps, bool sorted, size_t count, Row row, uint64_t t0, uint64_t t1,
+                     size_t& begin, size_t& end) {
+    if (sorted) {
+        begin = partition(count, [&](size_t i) { return timestamps[row(i)] < t0; });
+        end = partition(count, [&](size_t i) { return timestamps[row(i)] <= t1; });
+    } else {
+        begin = count;
+        end = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t time = timestamps[row(i)];
+            if (time < t0 || time > t1) continue;
+            begin = std::min(begin, i);
+            end = i + 1;
+        }
+    }
+    if (end < begin) end = begin;
+}
+
+template <typename T, typename Allocator>
+static size_t capacityBytes(const std::vector<T, Allocator>& vector) {
+    return vector.capacity() * sizeof(T);
+}
+
+CAN::MessageBuffer::Segment::Segment() {
+    timestamps.reserve(SEGMENT_FRAMES);
+    ids.reserve(SEGMENT_FRAMES);
+    flags.reserve(SEGMENT_FRAMES);
+    channels.reserve(SEGMENT_FRAMES);
+    lengths.reserve(SEGMENT_FRAMES);
+    offsets.reserve(SEGMENT_FRAMES);
+    streamRows.reserve(SEGMENT_FRAMES);
+    payload.reserve(SEGMENT_FRAMES * CLASSIC_DATA_LENGTH);
+}
+
+void CAN::MessageBuffer::Segment::sealStream(uint32_t id, Stream& stream, const Database* database) {
+    stream.rows.shrink_to_fit();
+    stream.layout = nullptr;
+    stream.layoutColumns = std::vector<uint32_t>();
+    if (stream.columns.empty()) return;
+
+    const MessageDescription* description = nullptr;
+    if (database) {
+        auto it = database->find(static_cast<int>(id));
+        if (it != database->end()) description = &it->second;
+    }
+    stream.packed.reserve(stream.columns.size());
+    for (size_t c = 0; c < stream.columns.size(); ++c) {
+        // Falls back to XOR compression if the description changed since the values were decoded
+        double scale = 1.0, offset = 0.0;
+        for (size_t i = 0; description && i < description->signals.size(); ++i) {
+            const SignalDescription& sigDes = description->signals[i];
+            if (sigDes.name == stream.names[c] && sigDes.valueType == SIG_INTEGER) {
+                scale = sigDes.scale;
+                offset = sigDes.offset;
+            }
+        }
+        stream.packed.emplace_back(stream.columns[c].data(), stream.columns[c].size(), scale, offset);
+    }
+    stream.columns.clear();
+    stream.columns.shrink_to_fit();
+}
+
+void CAN::MessageBuffer::Segment::seal(const Database* database, WorkerPool* pool) {
+    // Growth leaves up to half of a vector unused, a full segment no longer grows
+    payload.shrink_to_fit();
+    if (!pool) {
+        for (auto& [id, stream] : streams) sealStream(id, stream, database);
+    } else {
+        // Compression costs about as much as decoding, streams are compressed independently
+        std::vector<std::pair<uint32_t, Stream*>> work;
+        work.reserve(streams.size());
+        for (auto& [id, stream] : streams) work.emplace_back(id, &stream);
+        pool->run([&](size_t worker) {
+            for (size_t i = worker; i < work.size(); i += pool->size()) sealStream(work[i].first, *work[i].second, database);
+        });
+    }
+    arena.release();
+}
+
+void CAN::MessageBuffer::Segment::memory(MemoryUsage& usage) const {
+    usage.frames += sizeof(Segment) + capacityBytes(timestamps) + capacityBytes(ids) + capacityBytes(flags) + capacityBytes(channels) +
+                    capacityBytes(lengths) + capacityBytes(offsets) + capacityBytes(streamRows);
+    usage.payload += capacityBytes(payload);
+    usage.columns += arena.bytes(); // Columns of an open segment
+
+    // Hash table: bucket array plus one node per stream holding the next pointer and the value
+    usage.index += streams.bucket_count() * sizeof(void*) +
+                   streams.size() * (sizeof(void*) + sizeof(std::pair<const uint32_t, Stream>));
+    for (const auto& [id, stream] : streams) {
+        usage.index += capacityBytes(stream.rows) + capacityBytes(stream.layoutColumns);
+        usage.columns += capacityBytes(stream.columns) + capacityBytes(stream.packed);
+        for (const Codec::Column& column : stream.packed) usage.columns += column.bytes();
+        usage.strings += capacityBytes(stream.names);
+        for (const std::string& name : stream.names) {
+            // Short names live inside the string object
+            const char* object = reinterpret_cast<const char*>(&name);
+            if (name.data() < object || name.data() >= object + sizeof(std::string)) usage.strings += name.capacity() + 1;
+        }
+    }
+}
+
+void CAN::MessageBuffer::Segment::encode(std::vector<uint8_t>& out) const {
+    Codec::Writer writer(out);
+    size_t rows = size();
+    writer.putVarint(rows);
+    if (rows == 0) return;
+
+    writer.putTimestamps(timestamps.data(), rows);
+    for (size_t i = 0; i < rows; ++i) writer.putVarint(ids[i]);
+    for (size_t i = 0; i < rows; ++i) writer.putVarint(flags[i]);
+    writer.putBytes(channels.data(), rows);
+    writer.putBytes(lengths.data(), rows);
+
+    // Payload XORed with the previous frame of the same id, bytes that did not change become zero runs
+    std::vector<uint8_t> delta(payload);
+    for (const auto& [id, stream] : streams) {
+        for (size_t i = 1; i < stream.rows.size(); ++i) {
+            uint32_t row = stream.rows[i], previous = stream.rows[i - 1];
+            if (lengths[row] != lengths[previous]) continue;
+            for (size_t b = 0; b < lengths[row]; ++b) delta[offsets[row] + b] ^= payload[offsets[previous] + b];
+        }
+    }
+    writer.putPacked(delta.data(), delta.size());
+
+    // Only sealed segments are spilled, their columns are stored as they are held in memory
+    writer.putVarint(streams.size());
+    for (const auto& [id, stream] : streams) {
+        writer.putVarint(id);
+        writer.putVarint(stream.names.size());
+        for (size_t c = 0; c < stream.names.size(); ++c) {
+            writer.putString(stream.names[c]);
+            if (stream.columns.empty()) stream.packed[c].write(writer);
+            else Codec::Column(stream.columns[c].data(), stream.columns[c].size()).write(writer);
+        }
+    }
+}
+
+std::shared_ptr<CAN::MessageBuffer::Segment> CAN::MessageBuffer::Segment::decode(const std::vector<uint8_t>& in) {
+    Codec::Reader reader(in.data(), in.size());
+    auto segment = std::make_shared<Segment>();
+    size_t rows = reader.getVarint();
+    if (rows > SEGMENT_FRAMES) throw std::runtime_error("Spilled segment is corrupt");
+    if (rows == 0) return segment;
+
+    segment->timestamps.resize(rows);
+    reader.getTimestamps(segment->timestamps.data(), rows);
+    for (size_t i = 0; i < rows; ++i) {
+        if (i > 0 && segment->timestamps[i] < segment->timestamps[i - 1]) segment->sorted = false;
+        segment->first = std::min(segment->first, segment->timestamps[i]);
+        segment->last = std::max(segment->last, segment->timestamps[i]);
+    }
+    for (size_t i = 0; i < rows; ++i) segment->ids.push_back(static_cast<uint32_t>(reader.getVarint()));
+    for (size_t i = 0; i < rows; ++i) segment->flags.push_back(static_cast<uint32_t>(reader.getVarint()));
+    segment->channels.resize(rows);
+    reader.getBytes(segment->channels.data(), rows);
+    segment->lengths.resize(rows);
+    reader.getBytes(segment->lengths.data(), rows);
+
+    size_t bytes = 0;
+    for (uint8_t length : segment->lengths) {
+        if (length > MAX_DATA_LENGTH) throw std::runtime_error("Spilled segment is corrupt");
+        segment->offsets.push_back(static_cast<uint32_t>(bytes));
+        bytes += length;
+    }
+    segment->payload.resize(bytes);
+    reader.getPacked(segment->payload.data(), bytes);
+
+    for (size_t row = 0; row < rows; ++row) {
+        Stream& stream = segment->streams[segment->ids[row]];
+        if (!stream.rows.empty()) {
+            uint32_t previous = stream.rows.back();
+            if (segment->lengths[row] == segment->lengths[previous]) {
+                for (size_t b = 0; b < segment->lengths[row]; ++b) {
+                    segment->payload[segment->offsets[row] + b] ^= segment->payload[segment->offsets[previous] + b];
+                }
+            }
+        }
+        segment->streamRows.push_back(static_cast<uint32_t>(stream.rows.size()));
+        stream.rows.push_back(static_cast<uint32_t>(row));
+    }
+
+    size_t streams = reader.getVarint();
+    for (size_t s = 0; s < streams; ++s) {
+        auto it = segment->streams.find(static_cast<uint32_t>(reader.getVarint()));
+        if (it == segment->streams.end()) throw std::runtime_error("Spilled segment is corrupt");
+        Stream& stream = it->second;
+
+        size_t columns = reader.getVarint();
+        if (columns > 1 << 16) throw std::runtime_error("Spilled segment is corrupt");
+        for (size_t c = 0; c < columns; ++c) {
+            stream.names.push_back(reader.getString());
+
+            stream.packed.push_back(Codec::Column::read(reader));
+            if (stream.packed.back().size() != stream.rows.size()) throw std::runtime_error("Spilled segment is corrupt");
+        }
+    }
+    if (!reader.atEnd()) throw std::runtime_error("Spilled segment is corrupt");
+
+    segment->seal(nullptr);
+    return segment;
+}
+
+CAN::MessageBuffer::MessageBuffer(size_t budget, const DatabaseStore* database) : budget(budget), database(database) {
+
+}
+
+CAN::MessageBuffer::Segment& CAN::MessageBuffer::openSegment(const Database* snapshot) {
+    if (segments.empty() || segments.back()->size() == SEGMENT_FRAMES) {
+        if (!segments.empty()) {
+            segments.back()->seal(snapshot, pool.get());
+            MemoryUsage usage;
+            segments.back()->memory(usage);
+            sealedBytes += usage.total();
+        }
+        segments.push_back(std::make_shared<Segment>());
+        enforceBudget();
+    }
+    return *segments.back();
+}
+
+CAN::MessageBuffer::Stream& CAN::MessageBuffer::appendRow(Segment& segment, const Frame& frame) {
+    size_t length = std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH);
+    uint32_t row = static_cast<uint32_t>(segment.size());
+    if (row > 0 && frame.timestamp < segment.timestamps.back()) segment.sorted = false;
+    segment.first = std::min<uint64_t>(segment.first, frame.timestamp);
+    segment.last = std::max<uint64_t>(segment.last, frame.timestamp);
+    segment.timestamps.push_back(frame.timestamp);
+    segment.ids.push_back(static_cast<uint32_t>(frame.id));
+    segment.flags.push_back(static_cast<uint32_t>(frame.flags));
+    segment.channels.push_back(static_cast<uint8_t>(frame.obid));
+    segment.lengths.push_back(static_cast<uint8_t>(length));
+    segment.offsets.push_back(static_cast<uint32_t>(segment.payload.size()));
+    segment.payload.insert(segment.payload.end(), frame.data, frame.data + length);
+
+    Stream& stream = segment.streams[static_cast<uint32_t>(frame.id)];
+    segment.streamRows.push_back(static_cast<uint32_t>(stream.rows.size()));
+    stream.rows.push_back(row);
+    return stream;
+}
+
+void CAN::MessageBuffer::appendRows(Segment& segment, const Frame* frames, size_t count, const Database* snapshot) {
+    // Column by column, each sized once for the whole batch
+    size_t start = segment.size();
+    size_t payloadStart = segment.payload.size();
+    size_t payloadBytes = 0;
+    for (size_t i = 0; i < count; ++i) payloadBytes += std::min<size_t>(frames[i].sizeData, MAX_DATA_LENGTH);
+
+    segment.timestamps.resize(start + count);
+    segment.ids.resize(start + count);
+    segment.flags.resize(start + count);
+    segment.channels.resize(start + count);
+    segment.lengths.resize(start + count);
+    segment.offsets.resize(start + count);
+    segment.streamRows.resize(start + count);
+    segment.payload.resize(payloadStart + payloadBytes);
+
+    uint64_t previous = start > 0 ? segment.timestamps[start - 1] : 0;
+    uint64_t first = segment.first, last = segment.last;
+    bool sorted = segment.sorted;
+    uint32_t offset = static_cast<uint32_t>(payloadStart);
+    for (size_t i = 0; i < count; ++i) {
+        const Frame& frame = frames[i];
+        size_t row = start + i;
+        uint8_t length = static_cast<uint8_t>(std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH));
+        if (row > 0 && frame.timestamp < previous) sorted = false;
+        previous = frame.timestamp;
+        first = std::min(first, frame.timestamp);
+        last = std::max(last, frame.timestamp);
+        segment.timestamps[row] = frame.timestamp;
+        segment.ids[row] = static_cast<uint32_t>(frame.id);
+        segment.flags[row] = static_cast<uint32_t>(frame.flags);
+        segment.channels[row] = static_cast<uint8_t>(frame.obid);
+        segment.lengths[row] = length;
+        segment.offsets[row] = offset;
+        std::memcpy(segment.payload.data() + offset, frame.data, length);
+        offset += length;
+    }
+    segment.first = first;
+    segment.last = last;
+    segment.sorted = sorted;
+
+    // Ids repeat within a batch, a small direct mapped cache skips most stream and database lookups
+    struct Cached {
+        uint32_t id;
+        Stream* stream = nullptr;
+        const MessageDescription* description;
+    };
+    Cached cache[64];
+    jobs.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t id = static_cast<uint32_t>(frames[i].id);
+        Cached& cached = cache[id % 64];
+        if (!cached.stream || cached.id != id) cached = {id, &segment.streams[id], describe(snapshot, id)};
+        Stream& stream = *cached.stream;
+        segment.streamRows[start + i] = static_cast<uint32_t>(stream.rows.size());
+        jobs[i] = {&stream, decodable(frames[i]) ? cached.description : nullptr, static_cast<uint32_t>(stream.rows.size())};
+        stream.rows.push_back(static_cast<uint32_t>(start + i));
+    }
+}
+
+const CAN::MessageDescription* CAN::MessageBuffer::describe(const Database* snapshot, uint32_t id) {
+    if (!snapshot) return nullptr;
+    auto it = snapshot->find(static_cast<int>(id));
+    return it != snapshot->end() ? &it->second : nullptr;
+}
+
+void CAN::MessageBuffer::decodeRow(Stream& stream, size_t streamRow, const MessageDescription* description, const Frame& frame,
+                                   Arena& arena, std::vector<double>& values) {
+    if (!description) {
+        for (auto& column : stream.columns) column.push_back(std::nan(""));
+        return;
+    }
+
+    // Columns are matched by signal name, so a description that drops or reorders signals mid-segment
+    // keeps each column to its signal. Signals added mid-segment start with NaN for earlier rows.
+    size_t signals = description->signals.size();
+    if (stream.layout != description) {
+        stream.layout = description;
+        stream.layoutColumns.resize(signals);
+        for (size_t i = 0; i < signals; ++i) {
+            const std::string& name = description->signals[i].name;
+            size_t column = std::find(stream.names.begin(), stream.names.end(), name) - stream.names.begin();
+            if (column == stream.names.size()) {
+                stream.names.push_back(name);
+                stream.columns.emplace_back(streamRow, std::nan(""), ArenaAllocator<double>(&arena));
+            }
+            stream.layoutColumns[i] = static_cast<uint32_t>(column);
+        }
+    }
+
+    values.resize(signals);
+    decodeMessage(*description, frame.data, std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH), values.data());
+    for (auto& column : stream.columns) column.push_back(std::nan(""));
+    for (size_t i = 0; i < signals; ++i) stream.columns[stream.layoutColumns[i]].back() = values[i];
+}
+
+void CAN::MessageBuffer::checkLayouts() {
+    if (database.getVersion() == layoutVersion) return;
+    layoutVersion = database.getVersion();
+    if (segments.empty()) return;
+    for (auto& [id, stream] : segments.back()->streams) stream.layout = nullptr;
+}
+
+void CAN::MessageBuffer::addMessage(const Frame& frame) {
+    const Database* snapshot = database.get();
+    checkLayouts();
+    Segment& segment = openSegment(snapshot);
+    Stream& stream = appendRow(segment, frame);
+    decodeRow(stream, stream.rows.size() - 1, decodable(frame) ? describe(snapshot, static_cast<uint32_t>(frame.id)) : nullptr, frame,
+              segment.arena, values);
+    sequence++;
+}
+
+void CAN::MessageBuffer::addMessages(const Frame* frames, size_t count) {
+    const Database* snapshot = database.get();
+    checkLayouts();
+    sequence += count;
+    size_t done = 0;
+    while (done < count) {
+        // Chunks end at segment boundaries, a segment is sealed only once all of its columns are decoded
+        Segment& segment = openSegment(snapshot);
+        size_t chunk = std::min(count - done, SEGMENT_FRAMES - segment.size());
+        const Frame* first = frames + done;
+        done += chunk;
+
+        appendRows(segment, first, chunk, snapshot);
+        if (!pool || chunk < MIN_PARALLEL_FRAMES) {
+            for (size_t i = 0; i < chunk; ++i) decodeRow(*jobs[i].stream, jobs[i].streamRow, jobs[i].description, first[i], segment.arena, values);
+            continue;
+        }
+
+        // Rows were appended in order, the columns of each id are decoded by the one worker that owns the
+        // id so values keep the order of their frames. Streams are separate objects, workers share nothing.
+        size_t workers = pool->size();
+        scratch.resize(workers);
+        pool->run([&](size_t worker) {
+            for (size_t i = 0; i < chunk; ++i) {
+                if (first[i].id % workers != worker) continue;
+                decodeRow(*jobs[i].stream, jobs[i].streamRow, jobs[i].description, first[i], segment.arena, scratch[worker]);
+            }
+        });
+    }
+}
+
+void CAN::MessageBuffer::setDecodeThreads(size_t threads) {
+    if (threads == (pool ? pool->size() : 1)) return;
+    pool = threads > 1 ? std::make_unique<WorkerPool>(threads) : nullptr;
+}
+
+void CAN::MessageBuffer::spill(const Segment& segment) {
+    encoded.clear();
+    segment.encode(encoded);
+
+    Spilled entry;
+    entry.location = store->write(encoded);
+    entry.first = segment.first;
+    entry.last = segment.last;
+    entry.streams.reserve(segment.streams.size());
+    for (const auto& [id, stream] : segment.streams) entry.streams.emplace_back(id, static_cast<uint32_t>(stream.rows.size()));
+    std::sort(entry.streams.begin(), entry.streams.end());
+
+    spilledBytes += entry.memory();
+    spilled.push_back(std::move(entry));
+}
+
+void CAN::MessageBuffer::dropSpilled() {
+    const Spilled& oldest = spilled.front();
+    store->release(oldest.location);
+    spilledBytes -= oldest.memory();
+    evicted += SEGMENT_FRAMES;
+    dropped++;
+    spilled.pop_front();
+
+    cache.remove_if([this](const auto& entry) { return entry.first < dropped; });
+}
+
+void CAN::MessageBuffer::enforceBudget() {
+    auto used = [this]() {
+        MemoryUsage active;
+        segments.back()->memory(active);
+        for (const auto& [number, segment] : cache) segment->memory(active);
+        return sealedBytes + spilledBytes + derivedBytes + active.total();
+    };
+
+    // The segment taking new frames always stays in memory
+    while (segments.size() > 1 && used() > budget) {
+        const Segment& oldest = *segments.front();
+        MemoryUsage usage;
+        oldest.memory(usage);
+        sealedBytes -= usage.total();
+        size_t resident = (segments.size() - 1) * SEGMENT_FRAMES + segments.back()->size();
+        derivedBytes -= static_cast<size_t>(static_cast<double>(derivedBytes) * oldest.size() / resident);
+
+        if (store) {
+            try {
+                spill(oldest);
+            } catch (const std::runtime_error& e) {
+                // Spilled segments must stay older than the ones in memory, so they go before this one
+                spillError = e.what();
+                while (!spilled.empty()) dropSpilled();
+                store.reset();
+            }
+        }
+        if (!store) {
+            evicted += oldest.size();
+            dropped++;
+        }
+        segments.pop_front();
+    }
+
+    // A long capture can outgrow the budget with the spilled index alone
+    while (!spilled.empty() && (store->bytes() > diskBudget || used() > budget)) dropSpilled();
+}
+
+void CAN::MessageBuffer::setBudget(size_t bytes) {
+    budget = bytes;
+    if (!segments.empty()) enforceBudget();
+}
+
+void CAN::MessageBuffer::setSpill(const std::string& directory, uint64_t bytes) {
+    diskBudget = bytes;
+    spillError.clear();
+    if (!store || store->getDirectory() != directory) {
+        while (!spilled.empty()) dropSpilled();
+        store.reset();
+        if (!directory.empty()) store = std::make_unique<SegmentStore>(directory);
+    }
+    if (!segments.empty()) enforceBudget();
+}
+
+void CAN::MessageBuffer::clear() {
+    for (const Spilled& entry : spilled) store->release(entry.location);
+    dropped += spilled.size() + segments.size();
+    spilled.clear();
+    segments.clear();
+    cache.clear();
+    sealedBytes = 0;
+    spilledBytes = 0;
+}
+
+size_t CAN::MessageBuffer::size() const {
+    if (segments.empty()) return 0;
+    // Every segment but the last is full
+    return (spilled.size() + segments.size() - 1) * SEGMENT_FRAMES + segments.back()->size();
+}
+
+size_t CAN::MessageBuffer::sizeAt(uint64_t sequence) const {
+    size_t held = size();
+    // The oldest frame held has sequence number this->sequence - held
+    uint64_t newer = this->sequence - std::min(sequence, this->sequence);
+    return newer < held ? held - static_cast<size_t>(newer) : 0;
+}
+
+uint64_t CAN::MessageBuffer::getMemorySequence() const {
+    return sequence - (size() - spilled.size() * SEGMENT_FRAMES);
+}
+
+std::shared_ptr<const CAN::MessageBuffer::Segment> CAN::MessageBuffer::segment(size_t position) const {
+    if (position >= spilled.size()) return segments.at(position - spilled.size());
+
+    uint64_t number = dropped + position;
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->first == number) {
+            cache.splice(cache.begin(), cache, it);
+            return it->second;
+        }
+    }
+
+    std::shared_ptr<const Segment> loaded = Segment::decode(store->read(spilled[position].location));
+    cache.emplace_front(number, loaded);
+    if (cache.size() > CACHE_SEGMENTS) cache.pop_back();
+    return loaded;
+}
+
+void CAN::MessageBuffer::locate(size_t index, std::shared_ptr<const Segment>& segment, size_t& row) const {
+    if (index >= size()) throw std::out_of_range("MessageBuffer index out of range");
+    segment = this->segment(index / SEGMENT_FRAMES);
+    row = index % SEGMENT_FRAMES;
+}
+
+CAN::Frame CAN::MessageBuffer::frame(size_t index) const {
+    std::shared_ptr<const Segment> segment;
+    size_t row;
+    locate(index, segment, row);
+
+    Frame frame;
+    frame.timestamp = segment->timestamps[row];
+    frame.id = segment->ids[row];
+    frame.flags = segment->flags[row];
+    frame.obid = segment->channels[row];
+    frame.sizeData = segment->lengths[row];
+    std::memcpy(frame.data, segment->payload.data() + segment->offsets[row], frame.sizeData);
+    return frame;
+}
+
+double CAN::MessageBuffer::value(size_t index, const std::string& signal) const {
+    std::shared_ptr<const Segment> segment;
+    size_t row;
+    locate(index, segment, row);
+
+    const Stream& stream = segment->streams.at(segment->ids[row]);
+    for (size_t i = 0; i < stream.names.size(); ++i) {
+        if (stream.names[i] == signal) return stream.at(i, segment->streamRows[row]);
+    }
+    return std::nan("");
+}
+
+void CAN::MessageBuffer::bounds(size_t position, uint64_t& first, uint64_t& last) const {
+    if (position < spilled.size()) {
+        first = spilled[position].first;
+        last = spilled[position].last;
+    } else {
+        first = segments[position - spilled.size()]->first;
+        last = segments[position - spilled.size()]->last;
+    }
+}
+
+CAN::MessageBuffer::Span CAN::MessageBuffer::range(uint64_t t0, uint64_t t1) const {
+    Span span;
+    size_t positions = spilled.size() + segments.size();
+    if (positions == 0 || t0 > t1) return span;
+
+    // Segment bounds increase with ingest order except where channels overlap, so search, then widen
+    uint64_t first, last;
+    auto lastBefore = [&](size_t position) { bounds(position, first, last); return last < t0; };
+    auto firstBefore = [&](size_t position) { bounds(position, first, last); return first <= t1; };
+    size_t low = partition(positions, lastBefore);
+    while (low > 0 && !lastBefore(low - 1)) low--;
+    size_t high = partition(positions, firstBefore);
+    while (high < positions && firstBefore(high)) high++;
+
+    if (low >= high) {
+        span.begin = span.end = std::min(low * SEGMENT_FRAMES, size());
+        return span;
+    }
+
+    size_t begin, end, unused;
+    std::shared_ptr<const Segment> segment = this->segment(low);
+    rowRange(segment->timestamps, segment->sorted, segment->size(), [](size_t i) { return i; }, t0, t1, begin, unused);
+    span.begin = low * SEGMENT_FRAMES + begin;
+
+    segment = this->segment(high - 1);
+    rowRange(segment->timestamps, segment->sorted, segment->size(), [](size_t i) { return i; }, t0, t1, unused, end);
+    span.end = std::max(span.begin, (high - 1) * SEGMENT_FRAMES + end);
+    return span;
+}
+
+CAN::MessageBuffer::Series CAN::MessageBuffer::series(unsigned long id, const std::string& signal, uint64_t sequence) const {
+    Series series;
+    series.buffer = this;
+    series.id = static_cast<uint32_t>(id);
+    series.signal = signal;
+
+    // Segments before the cut are whole, the rows of the one it falls in are counted up to it
+    size_t held = sizeAt(sequence);
+    size_t whole = held / SEGMENT_FRAMES;
+    for (size_t i = 0; i < spilled.size() && i < whole; ++i) {
+        const auto& streams = spilled[i].streams;
+        auto it = std::lower_bound(streams.begin(), streams.end(), std::make_pair(series.id, uint32_t(0)));
+        if (it == streams.end() || it->first != series.id) continue;
+        series.parts.push_back({dropped + i, series.count});
+        series.count += it->second;
+    }
+    for (size_t i = 0; i < segments.size() && spilled.size() + i < whole; ++i) {
+        auto it = segments[i]->streams.find(series.id);
+        if (it == segments[i]->streams.end()) continue;
+        series.parts.push_back({dropped + spilled.size() + i, series.count});
+        series.count += it->second.rows.size();
+    }
+    if (held % SEGMENT_FRAMES != 0) {
+        std::shared_ptr<const Segment> cut = segment(whole);
+        auto it = cut->streams.find(series.id);
+        if (it != cut->streams.end()) {
+            const std::vector<uint32_t>& rows = it->second.rows;
+            size_t count = std::lower_bound(rows.begin(), rows.end(), static_cast<uint32_t>(held % SEGMENT_FRAMES)) - rows.begin();
+            if (count > 0) series.parts.push_back({dropped + whole, series.count});
+            series.count += count;
+        }
+    }
+    return series;
+}
+
+CAN::MemoryUsage CAN::MessageBuffer::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& segment : segments) segment->memory(usage);
+    usage.index += capacityBytes(values) + capacityBytes(jobs) + spilledBytes;
+
+    MemoryUsage cached;
+    for (const auto& [number, segment] : cache) segment->memory(cached);
+    usage.cache = cached.total();
+    usage.derived = derivedBytes;
+    return usage;
+}
+
+size_t CAN::MessageBuffer::Series::find(size_t index) const {
+    if (last >= parts.size() || index < parts[last].start || index >= (last + 1 < parts.size() ? parts[last + 1].start : count)) {
+        if (index >= count) throw std::out_of_range("Series index out of range");
+        auto it = std::upper_bound(parts.begin(), parts.end(), index, [](size_t i, const Part& part) {
+            return i < part.start;
+        });
+        last = static_cast<size_t>(it - parts.begin()) - 1;
+
+        if (parts[last].segment < buffer->dropped) throw std::out_of_range("Series segment was dropped");
+        segment = buffer->segment(static_cast<size_t>(parts[last].segment - buffer->dropped));
+        stream = &segment->streams.at(id);
+        column = SIZE_MAX;
+        blockIndex = SIZE_MAX;
+        for (size_t i = 0; i < stream->names.size(); ++i) {
+            if (stream->names[i] == signal) column = i;
+        }
+    }
+    return index - parts[last].start;
+}
+
+uint64_t CAN::MessageBuffer::Series::time(size_t index) const {
+    size_t local = find(index);
+    return segment->timestamps[stream->rows[local]];
+}
+
+double CAN::MessageBuffer::Series::value(size_t index) const {
+    size_t local = find(index);
+    if (column == SIZE_MAX) return std::nan("");
+    if (!stream->columns.empty()) return stream->columns[column][local];
+
+    // Plots read in order, so each block is decoded once
+    size_t number = local / Codec::Column::BLOCK;
+    if (number != blockIndex) {
+        block.resize(Codec::Column::BLOCK);
+        stream->packed[column].decode(number, block.data());
+        blockIndex = number;
+    }
+    return block[local % Codec::Column::BLOCK];
+}
+
+CAN::MessageBuffer::Span CAN::MessageBuffer::Series::range(uint64_t t0, uint64_t t1) const {
+    Span span;
+    if (parts.empty() || t0 > t1) return span;
+
+    uint64_t first, last;
+    auto position = [&](size_t part) { return static_cast<size_t>(parts[part].segment - buffer->dropped); };
+    auto lastBefore = [&](size_t part) { buffer->bounds(position(part), first, last); return last < t0; };
+    auto firstBefore = [&](size_t part) { buffer->bounds(position(part), first, last); return first <= t1; };
+    size_t low = partition(parts.size(), lastBefore);
+    while (low > 0 && !lastBefore(low - 1)) low--;
+    size_t high = partition(parts.size(), firstBefore);
+    while (high < parts.size() && firstBefore(high)) high++;
+
+    if (low >= high) {
+        span.begin = span.end = low < parts.size() ? parts[low].start : count;
+        return span;
+    }
+
+    // The segment bounds cover every id, the stream's own rows decide within the boundary parts. A series
+    // of an earlier sequence number holds only the rows before it of its last segment.
+    auto rows = [&](size_t part) { return (part + 1 < parts.size() ? parts[part + 1].start : count) - parts[part].start; };
+    size_t begin, end, unused;
+    find(parts[low].start);
+    rowRange(segment->timestamps, segment->sorted, rows(low), [this](size_t i) { return stream->rows[i]; }, t0, t1, begin, unused);
+    span.begin = std::min(parts[low].start + begin, count);
+
+    find(parts[high - 1].start);
+    rowRange(segment->timestamps, segment->sorted, rows(high - 1), [this](size_t i) { return stream->rows[i]; }, t0, t1, unused, end);
+    span.end = std::min(std::max(span.begin, parts[high - 1].start + end), count);
+    return span;
+}
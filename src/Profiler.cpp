@@ -0,0 +1,79 @@
+#include "Profiler.h"
+
+#include <deque>
+#include <mutex>
+#include <algorithm>
+
+namespace {
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> newestFrame{0};
+
+    std::mutex registryMutex;
+    std::deque<Profiler::Timer>& registry() {
+        static std::deque<Profiler::Timer> timers;
+        return timers;
+    }
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+void Profiler::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+Profiler::Timer& Profiler::timer(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (Timer& timer : registry()) {
+        if (timer.getName() == name) return timer;
+    }
+    return registry().emplace_back(name);
+}
+
+std::vector<Profiler::Statistics> Profiler::statistics() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<Statistics> result;
+    for (const Timer& timer : registry()) result.push_back(timer.statistics());
+    return result;
+}
+
+Profiler::Statistics Profiler::Timer::statistics() const {
+    Statistics statistics{name, count.load(std::memory_order_relaxed), 0, 0, 0, 0};
+    size_t n = static_cast<size_t>(std::min<uint64_t>(statistics.count, SAMPLES));
+    if (n == 0) return statistics;
+
+    std::vector<uint64_t> window(n);
+    for (size_t i = 0; i < n; ++i) window[i] = samples[i].load(std::memory_order_relaxed);
+
+    double sum = 0;
+    for (uint64_t sample : window) sum += sample;
+    statistics.mean = sum / n / 1000.0;
+
+    auto percentile = [&](double p) {
+        auto it = window.begin() + static_cast<size_t>(p * (n - 1));
+        std::nth_element(window.begin(), it, window.end());
+        return *it / 1000.0;
+    };
+    statistics.p50 = percentile(0.50);
+    statistics.p99 = percentile(0.99);
+    statistics.max = *std::max_element(window.begin(), window.end()) / 1000.0;
+    return statistics;
+}
+
+void Profiler::markIngest(uint64_t timestamp) {
+    if (!isEnabled()) return;
+    uint64_t newest = newestFrame.load(std::memory_order_relaxed);
+    while (timestamp > newest && !newestFrame.compare_exchange_weak(newest, timestamp, std::memory_order_relaxed)) {}
+}
+
+void Profiler::markPaint() {
+    static Timer& latency = timer("latency/frame_to_paint");
+    uint64_t frame = newestFrame.exchange(0, std::memory_order_relaxed);
+    int64_t paint = now();
+    if (frame != 0 && isEnabled() && paint > static_cast<int64_t>(frame)) latency.record(static_cast<uint64_t>(paint) - frame);
+}
@@ -0,0 +1,81 @@
+#include "SegmentStore.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+CAN::SegmentStore::SegmentStore(const std::string& directory) : directory(directory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) throw std::runtime_error("Could not create spill directory: " + directory);
+}
+
+CAN::SegmentStore::~SegmentStore() {
+    if (current) std::fclose(current);
+    std::error_code error;
+    for (const File& file : files) std::filesystem::remove(path(file.number), error);
+}
+
+std::string CAN::SegmentStore::path(uint64_t file) const {
+    return (std::filesystem::path(directory) / ("segments_" + std::to_string(file) + ".cvs")).string();
+}
+
+CAN::SegmentStore::File* CAN::SegmentStore::find(uint64_t file) {
+    // Files are numbered consecutively
+    if (files.empty() || file < files.front().number) return nullptr;
+    size_t index = static_cast<size_t>(file - files.front().number);
+    return index < files.size() ? &files[index] : nullptr;
+}
+
+CAN::SegmentStore::Location CAN::SegmentStore::write(const std::vector<uint8_t>& block) {
+    if (!current || files.back().bytes >= FILE_SIZE) {
+        if (current) std::fclose(current);
+        files.push_back(File{nextFile++});
+        current = std::fopen(path(files.back().number).c_str(), "wb");
+        if (!current) {
+            files.pop_back();
+            throw std::runtime_error("Could not open spill file: " + path(nextFile - 1));
+        }
+        // The previous file may already be fully released
+        removeReleased();
+    }
+
+    File& file = files.back();
+    Location location{file.number, file.bytes, static_cast<uint32_t>(block.size())};
+    // Flushed right away, reads go through their own handle
+    if (std::fwrite(block.data(), 1, block.size(), current) != block.size() || std::fflush(current) != 0) {
+        throw std::runtime_error("Could not write spill file: " + path(file.number));
+    }
+    file.bytes += block.size();
+    file.blocks++;
+    liveBytes += block.size();
+    return location;
+}
+
+std::vector<uint8_t> CAN::SegmentStore::read(const Location& location) const {
+    std::FILE* file = std::fopen(path(location.file).c_str(), "rb");
+    if (!file) throw std::runtime_error("Could not open spill file: " + path(location.file));
+
+    std::vector<uint8_t> block(location.size);
+    bool ok = std::fseek(file, static_cast<long>(location.offset), SEEK_SET) == 0 &&
+              std::fread(block.data(), 1, block.size(), file) == block.size();
+    std::fclose(file);
+    if (!ok) throw std::runtime_error("Could not read spill file: " + path(location.file));
+    return block;
+}
+
+void CAN::SegmentStore::release(const Location& location) {
+    File* file = find(location.file);
+    if (!file || file->blocks == 0) return;
+    file->blocks--;
+    liveBytes -= location.size;
+    removeReleased();
+}
+
+void CAN::SegmentStore::removeReleased() {
+    // Blocks are released oldest first, so only leading files can become empty. The current file stays.
+    std::error_code error;
+    while (files.size() > 1 && files.front().blocks == 0) {
+        std::filesystem::remove(path(files.front().number), error);
+        files.pop_front();
+    }
+}
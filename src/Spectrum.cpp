@@ -0,0 +1,248 @@
+#include "Spectrum.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+static constexpr double PI = 3.14159265358979323846;
+
+void CAN::resample(const uint64_t* times, const double* values, size_t samples, uint64_t t0, uint64_t t1, double* out, size_t count) {
+    if (count == 0) return;
+    if (samples == 0) {
+        std::fill(out, out + count, 0.0);
+        return;
+    }
+
+    double step = count > 1 ? static_cast<double>(t1 - t0) / (count - 1) : 0;
+    size_t j = 0;
+    for (size_t i = 0; i < count; ++i) {
+        double t = t0 + i * step;
+        while (j + 1 < samples && times[j + 1] <= t) j++;
+        if (t <= times[0]) out[i] = values[0];
+        else if (j + 1 >= samples) out[i] = values[samples - 1];
+        else out[i] = values[j] + (values[j + 1] - values[j]) * ((t - times[j]) / (times[j + 1] - times[j]));
+    }
+}
+
+void CAN::downsample(const uint64_t* times, const double* values, size_t samples, uint64_t t0, uint64_t t1, double* out, size_t count) {
+    if (count < 2 || samples < 2 || t1 <= t0) return resample(times, values, samples, t0, t1, out, count);
+
+    // Integral of the interpolated samples from the first one, constant before and after them
+    std::vector<double> integral(samples);
+    for (size_t j = 1; j < samples; ++j) {
+        integral[j] = integral[j - 1] + (values[j - 1] + values[j]) / 2 * static_cast<double>(times[j] - times[j - 1]);
+    }
+    auto area = [&](double t, size_t& j) {
+        if (t <= times[0]) return values[0] * (t - times[0]);
+        while (j + 1 < samples && times[j + 1] <= t) j++;
+        double dt = t - times[j];
+        if (j + 1 >= samples) return integral[j] + values[j] * dt;
+        double slope = (values[j + 1] - values[j]) / static_cast<double>(times[j + 1] - times[j]);
+        return integral[j] + values[j] * dt + slope * dt * dt / 2;
+    };
+
+    double step = static_cast<double>(t1 - t0) / (count - 1);
+    size_t below = 0, above = 0;
+    for (size_t i = 0; i < count; ++i) {
+        double t = t0 + i * step;
+        double start = area(t - step / 2, below);
+        out[i] = (area(t + step / 2, above) - start) / step;
+    }
+}
+
+CAN::FFT::FFT(size_t size) : size(size) {
+    if (size < 4 || size > (size_t(1) << 26) || (size & (size - 1)) != 0) {
+        throw std::runtime_error("FFT size must be a power of two from 4 to 2^26");
+    }
+
+    // Periodic Hann window
+    window.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * PI * i / size);
+        gain += window[i];
+    }
+
+    size_t half = size / 2;
+    size_t bits = 0;
+    while ((size_t(1) << bits) < half) bits++;
+    reversed.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        uint32_t r = 0;
+        for (size_t b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed[i] = r;
+    }
+
+    // The stage joining blocks of length h uses e^(-i pi j / h) for j < h, stored from offset h - 1
+    for (size_t h = 1; h < half; h *= 2) {
+        for (size_t j = 0; j < h; ++j) {
+            cosines.push_back(std::cos(-PI * j / h));
+            sines.push_back(std::sin(-PI * j / h));
+        }
+    }
+    unpackCosines.resize(half + 1);
+    unpackSines.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        unpackCosines[k] = std::cos(-2 * PI * k / size);
+        unpackSines[k] = std::sin(-2 * PI * k / size);
+    }
+
+    re.resize(half);
+    im.resize(half);
+}
+
+void CAN::FFT::transform() {
+    size_t n = re.size();
+    for (size_t h = 1; h < n; h *= 2) {
+        const double* wr = cosines.data() + h - 1;
+        const double* wi = sines.data() + h - 1;
+        for (size_t start = 0; start < n; start += 2 * h) {
+            double* ar = re.data() + start;
+            double* ai = im.data() + start;
+            double* br = ar + h;
+            double* bi = ai + h;
+            for (size_t j = 0; j < h; ++j) {
+                double tr = br[j] * wr[j] - bi[j] * wi[j];
+                double ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+void CAN::FFT::amplitudes(const double* samples, double* out) {
+    // Even samples are the real part, odd ones the imaginary part, loaded in bit reversed order
+    size_t half = size / 2;
+    for (size_t k = 0; k < half; ++k) {
+        size_t i = 2 * static_cast<size_t>(reversed[k]);
+        re[k] = samples[i] * window[i];
+        im[k] = samples[i + 1] * window[i + 1];
+    }
+    transform();
+
+    // X[k] = E[k] + w^k O[k], with E and O the transforms of the even and odd samples
+    for (size_t k = 0; k <= half; ++k) {
+        size_t a = k % half, b = (half - k) % half;
+        double evenRe = (re[a] + re[b]) / 2, evenIm = (im[a] - im[b]) / 2;
+        double oddRe = (im[a] + im[b]) / 2, oddIm = -(re[a] - re[b]) / 2;
+        double xr = evenRe + unpackCosines[k] * oddRe - unpackSines[k] * oddIm;
+        double xi = evenIm + unpackCosines[k] * oddIm + unpackSines[k] * oddRe;
+        double scale = (k == 0 || k == half) ? 1 / gain : 2 / gain;
+        out[k] = std::sqrt(xr * xr + xi * xi) * scale;
+    }
+}
+
+CAN::Spectrogram::Spectrogram(size_t size, double rate) : fft(size), hop(size / 2), rate(rate) {
+    if (!(rate > 0)) throw std::runtime_error("Spectrogram rate must be positive");
+    spectrum.resize(fft.bins());
+    rowData.resize(ROWS * fft.bins());
+    rowLow.resize(ROWS);
+    rowHigh.resize(ROWS);
+    due = size;
+    thread = std::thread(&Spectrogram::work, this);
+}
+
+CAN::Spectrogram::~Spectrogram() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void CAN::Spectrogram::push(const uint64_t* times, const double* values, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingTimes.insert(pendingTimes.end(), times, times + count);
+        pendingValues.insert(pendingValues.end(), values, values + count);
+    }
+    wake.notify_one();
+}
+
+void CAN::Spectrogram::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !pendingTimes.empty(); });
+        if (stopping) return;
+        times.swap(pendingTimes);
+        values.swap(pendingValues);
+        pendingTimes.clear();
+        pendingValues.clear();
+
+        lock.unlock();
+        feed();
+        lock.lock();
+    }
+}
+
+void CAN::Spectrogram::feed() {
+    double period = 1e9 / rate;
+    for (size_t i = 0; i < times.size(); ++i) {
+        uint64_t t = times[i];
+        double v = values[i];
+        if (std::isnan(v)) continue;
+        if (!started) {
+            started = true;
+            origin = lastTime = t;
+            lastValue = v;
+        }
+        if (t < lastTime) continue;
+
+        // Uniform samples up to t lie between the previous sample and this one
+        while (true) {
+            uint64_t next = origin + static_cast<uint64_t>(index * period);
+            if (next > t) break;
+            double f = t > lastTime ? static_cast<double>(next - lastTime) / (t - lastTime) : 1.0;
+            uniform.push_back(lastValue + (v - lastValue) * f);
+            index++;
+            if (--due == 0) {
+                addRow();
+                due = hop;
+            }
+        }
+        lastTime = t;
+        lastValue = v;
+    }
+
+    size_t size = fft.getSize();
+    if (uniform.size() > 4 * size) uniform.erase(uniform.begin(), uniform.end() - size);
+}
+
+void CAN::Spectrogram::addRow() {
+    size_t size = fft.getSize();
+    fft.amplitudes(uniform.data() + uniform.size() - size, spectrum.data());
+
+    size_t bins = fft.bins();
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t slot = (first + count) % ROWS;
+    if (count == ROWS) first = (first + 1) % ROWS;
+    else count++;
+
+    float* row = rowData.data() + slot * bins;
+    for (size_t k = 0; k < bins; ++k) row[k] = static_cast<float>(20 * std::log10(spectrum[k] + 1e-12));
+    rowLow[slot] = *std::min_element(row, row + bins);
+    rowHigh[slot] = *std::max_element(row, row + bins);
+
+    low = rowLow[first];
+    high = rowHigh[first];
+    for (size_t r = 1; r < count; ++r) {
+        low = std::min(low, rowLow[(first + r) % ROWS]);
+        high = std::max(high, rowHigh[(first + r) % ROWS]);
+    }
+}
+
+size_t CAN::Spectrogram::rows(std::vector<float>& out, float& low, float& high) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bins = fft.bins();
+    out.resize(count * bins);
+    for (size_t r = 0; r < count; ++r) {
+        const float* row = rowData.data() + ((first + r) % ROWS) * bins;
+        std::copy(row, row + bins, out.data() + r * bins);
+    }
+    low = this->low;
+    high = this->high;
+    return count;
+}
@@ -0,0 +1,231 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+CAN::BusStatistics::BusStatistics(const DatabaseStore* database, unsigned long bitrate, unsigned long dataBitrate)
+    : database(database), bitrate(bitrate), dataBitrate(dataBitrate) {}
+
+void CAN::BusStatistics::setBitrate(unsigned long bitrate, unsigned long dataBitrate) {
+    this->bitrate = bitrate;
+    this->dataBitrate = dataBitrate;
+}
+
+void CAN::BusStatistics::add(const Frame& frame) {
+    if (!started) {
+        started = true;
+        windowStart = frame.timestamp;
+    }
+    uint64_t elapsed = frame.timestamp - windowStart;
+    if (elapsed >= WINDOW) closeWindow(frame.timestamp);
+
+    unsigned nominalBits, dataBits;
+    frameBits(frame, nominalBits, dataBits);
+    double time = static_cast<double>(nominalBits) / bitrate + static_cast<double>(dataBits) / dataBitrate;
+
+    channel.frames++;
+    channel.bits += nominalBits + dataBits;
+    windowFrames++;
+    windowTime += time;
+
+    if (frame.flags & MSG_FLAG_ERROR) {
+        channel.errorFrames++;
+        return;
+    }
+
+    uint64_t key = frame.id | (static_cast<uint64_t>(frame.flags & MSG_FLAG_EXTENDED) << 32);
+    IDStatistics& statistics = ids[key];
+    const MessageDescription* description = nullptr;
+    if (const Database* snapshot = database.get()) {
+        auto it = snapshot->find(static_cast<int>(frame.id));
+        if (it != snapshot->end()) description = &it->second;
+    }
+
+    if (statistics.count == 0) {
+        statistics.id = frame.id;
+        statistics.expectedLength = description ? static_cast<uint8_t>(description->length) : frame.sizeData;
+    } else {
+        double cycle = static_cast<double>(frame.timestamp - statistics.lastTimestamp) / 1000.0;
+
+        // Gaps are judged against the database cycle time, else against the measured mean
+        double expected = 0;
+        if (description && description->cycleTime > 0) expected = description->cycleTime * 1000.0;
+        else if (statistics.cycles >= MIN_CYCLES) expected = statistics.cycleMean;
+        if (expected > 0 && cycle > 1.5 * expected) statistics.gaps++;
+
+        // Welford's running mean and variance
+        statistics.cycles++;
+        double delta = cycle - statistics.cycleMean;
+        statistics.cycleMean += delta / statistics.cycles;
+        statistics.cycleM2 += delta * (cycle - statistics.cycleMean);
+        statistics.jitter = statistics.cycles > 1 ? std::sqrt(statistics.cycleM2 / (statistics.cycles - 1)) : 0;
+        statistics.cycleMin = statistics.cycles == 1 ? cycle : std::min(statistics.cycleMin, cycle);
+        statistics.cycleMax = std::max(statistics.cycleMax, cycle);
+    }
+
+    if (!(frame.flags & MSG_FLAG_RTR) && frame.sizeData != statistics.expectedLength) statistics.dlcViolations++;
+
+    statistics.flags = frame.flags & (MSG_FLAG_EXTENDED | MSG_FLAG_FD);
+    statistics.count++;
+    statistics.bits += nominalBits + dataBits;
+    statistics.lastTimestamp = frame.timestamp;
+    statistics.windowCount++;
+    statistics.windowTime += time;
+}
+
+void CAN::BusStatistics::add(const Frame* frames, size_t count) {
+    for (size_t i = 0; i < count; ++i) add(frames[i]);
+}
+
+void CAN::BusStatistics::closeWindow(uint64_t now) {
+    double seconds = static_cast<double>(now - windowStart) / 1e9;
+
+    channel.framesPerSecond = windowFrames / seconds;
+    channel.load = windowTime / seconds;
+    channel.peakLoad = std::max(channel.peakLoad, channel.load);
+
+    for (auto& [key, statistics] : ids) {
+        statistics.rate = statistics.windowCount / seconds;
+        statistics.load = statistics.windowTime / seconds;
+        statistics.windowCount = 0;
+        statistics.windowTime = 0;
+    }
+
+    windowStart = now;
+    windowFrames = 0;
+    windowTime = 0;
+}
+
+void CAN::BusStatistics::merge(const CANALSTATISTICS& driver) {
+    channel.hasDriver = true;
+    channel.overruns = driver.cntOverruns;
+    channel.busWarnings = driver.cntBusWarnings;
+    channel.busOff = driver.cntBusOff;
+}
+
+void CAN::BusStatistics::reset() {
+    ids.clear();
+    channel = ChannelStatistics();
+    started = false;
+    windowFrames = 0;
+    windowTime = 0;
+}
+
+std::vector<CAN::IDStatistics> CAN::BusStatistics::getIDs() const {
+    std::vector<IDStatistics> result;
+    result.reserve(ids.size());
+    for (const auto& [key, statistics] : ids) result.push_back(statistics);
+    std::sort(result.begin(), result.end(), [](const IDStatistics& a, const IDStatistics& b) {
+        return a.id < b.id;
+    });
+    return result;
+}
+
+CAN::QuantileEstimator::QuantileEstimator(double quantile) : quantile(quantile) {
+    double p = quantile;
+    const double start[5] = {1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5};
+    const double step[5] = {0, p / 2, p, (1 + p) / 2, 1};
+    for (int i = 0; i < 5; ++i) {
+        positions[i] = i + 1;
+        desired[i] = start[i];
+        increments[i] = step[i];
+    }
+}
+
+double CAN::QuantileEstimator::parabolic(int i, double d) const {
+    return heights[i] + d / (positions[i + 1] - positions[i - 1]) *
+                            ((positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+                             (positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+}
+
+double CAN::QuantileEstimator::linear(int i, int d) const {
+    return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+}
+
+void CAN::QuantileEstimator::add(double x) {
+    // The first five samples are the initial marker heights
+    if (count < 5) {
+        heights[count++] = x;
+        if (count == 5) std::sort(heights, heights + 5);
+        return;
+    }
+    count++;
+
+    int cell;
+    if (x < heights[0]) {
+        heights[0] = x;
+        cell = 0;
+    } else if (x >= heights[4]) {
+        heights[4] = x;
+        cell = 3;
+    } else {
+        cell = 0;
+        while (x >= heights[cell + 1]) cell++;
+    }
+    for (int i = cell + 1; i < 5; ++i) positions[i]++;
+    for (int i = 0; i < 5; ++i) desired[i] += increments[i];
+
+    // Markers off their desired position by one or more move one step, keeping the heights ordered
+    for (int i = 1; i < 4; ++i) {
+        double offset = desired[i] - positions[i];
+        if ((offset >= 1 && positions[i + 1] - positions[i] > 1) || (offset <= -1 && positions[i - 1] - positions[i] < -1)) {
+            int d = offset > 0 ? 1 : -1;
+            double height = parabolic(i, d);
+            heights[i] = heights[i - 1] < height && height < heights[i + 1] ? height : linear(i, d);
+            positions[i] += d;
+        }
+    }
+}
+
+double CAN::QuantileEstimator::value() const {
+    if (count == 0) return std::nan("");
+    if (count >= 5) return heights[2];
+
+    double sorted[5];
+    std::copy(heights, heights + count, sorted);
+    std::sort(sorted, sorted + count);
+    return sorted[static_cast<size_t>(std::lround(quantile * (count - 1)))];
+}
+
+void CAN::RunningStatistics::add(double x) {
+    if (std::isnan(x)) return;
+    count++;
+    if (count == 1) {
+        min = max = x;
+    } else {
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+    double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+    for (QuantileEstimator& estimator : quantiles) estimator.add(x);
+}
+
+CAN::SignalStatistics::SignalStatistics(const DatabaseStore* database) : database(database) {}
+
+void CAN::SignalStatistics::add(const Frame* frames, size_t count) {
+    const Database* snapshot = database.get();
+    if (!snapshot) return;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Frame& frame = frames[i];
+        if (frame.flags & (MSG_FLAG_RTR | MSG_FLAG_ERROR)) continue;
+        auto it = snapshot->find(static_cast<int>(frame.id));
+        if (it == snapshot->end() || !it->second.plot) continue;
+
+        const MessageDescription& description = it->second;
+        std::vector<RunningStatistics>& statistics = ids[frame.id];
+        if (statistics.size() != description.signals.size()) statistics.assign(description.signals.size(), RunningStatistics());
+
+        values.resize(description.signals.size());
+        decodeMessage(description, frame.data, std::min<size_t>(frame.sizeData, MAX_DATA_LENGTH), values.data());
+        for (size_t signal = 0; signal < values.size(); ++signal) statistics[signal].add(values[signal]);
+    }
+}
+
+const CAN::RunningStatistics* CAN::SignalStatistics::get(unsigned long id, size_t signal) const {
+    auto it = ids.find(id);
+    if (it == ids.end() || signal >= it->second.size()) return nullptr;
+    return &it->second[signal];
+}
@@ -0,0 +1,129 @@
+#include "Synthetic.h"
+
+#include <random>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+CAN::Database CAN::syntheticDatabase(const SyntheticOptions& options) {
+    static const unsigned long cycleTimes[] = {10, 20, 50, 100, 200, 1000};
+
+    std::mt19937 rng(options.seed);
+    Database database;
+
+    for (size_t m = 0; m < options.messages; ++m) {
+        MessageDescription message;
+        message.id = static_cast<unsigned long>(0x100 + m);
+        message.name = "Message" + std::to_string(m);
+        message.sender = "Vector__XXX";
+        message.cycleTime = cycleTimes[rng() % 6];
+
+        bool fd = std::uniform_real_distribution<double>(0, 1)(rng) < options.fdRatio;
+        message.length = fd ? MAX_DATA_LENGTH : CLASSIC_DATA_LENGTH;
+
+        // Spread the signals evenly over the payload
+        size_t count = std::max<size_t>(1, std::min(options.signalsPerMessage, message.length * 8));
+        // Byte aligned slots keep Intel and Motorola signals from overlapping
+        size_t width = message.length * 8 / count;
+        if (width >= 8) width -= width % 8;
+        for (size_t s = 0; s < count; ++s) {
+            SignalDescription signal;
+            signal.name = message.name + "_Signal" + std::to_string(s);
+            signal.length = std::min<size_t>(std::max<size_t>(1, rng() % width + 1), 32);
+            signal.endianess = width % 8 == 0 && rng() % 2 ? SIGNAL_BIG_ENDIAN : SIGNAL_LITTLE_ENDIAN;
+            size_t lsb = s * width;
+            // Motorola start bits name the MSB
+            int msb = static_cast<int>(lsb + width - signal.length);
+            signal.startBit = signal.endianess == SIGNAL_LITTLE_ENDIAN ? static_cast<int>(lsb) : (msb / 8) * 8 + 7 - msb % 8;
+            signal.signedness = rng() % 2 ? SIGNED : UNSIGNED;
+            signal.scale = rng() % 2 ? 1.0f : 0.1f;
+            signal.offset = 0;
+            double range = std::ldexp(1.0, static_cast<int>(signal.length) - (signal.signedness ? 1 : 0)) - 1;
+            signal.min = signal.signedness ? static_cast<float>(-range * signal.scale) : 0.0f;
+            signal.max = static_cast<float>(range * signal.scale);
+            signal.unit = "";
+            signal.compile();
+            message.signals.push_back(signal);
+        }
+
+        database[message.id] = message;
+    }
+
+    return database;
+}
+
+CAN::SyntheticGenerator::SyntheticGenerator(const Database& database) : database(database) {
+    std::mt19937 rng(1);
+    for (const auto& [id, description] : this->database) {
+        Stream stream;
+        stream.description = &description;
+        stream.period = (description.cycleTime > 0 ? description.cycleTime : 100) * 1000000ULL;
+        stream.next = rng() % stream.period;
+        stream.values.resize(description.signals.size());
+        for (size_t i = 0; i < description.signals.size(); ++i) {
+            stream.frequencies.push_back(0.05 + std::uniform_real_distribution<double>(0, 2)(rng));
+        }
+        streams.push_back(stream);
+        heap.push_back(streams.size() - 1);
+    }
+
+    auto later = [this](size_t a, size_t b) { return streams[a].next > streams[b].next; };
+    std::make_heap(heap.begin(), heap.end(), later);
+}
+
+CAN::Frame CAN::SyntheticGenerator::next() {
+    Frame frame;
+    if (heap.empty()) return frame;
+
+    auto later = [this](size_t a, size_t b) { return streams[a].next > streams[b].next; };
+    std::pop_heap(heap.begin(), heap.end(), later);
+    Stream& stream = streams[heap.back()];
+
+    const MessageDescription& description = *stream.description;
+    double seconds = stream.next / 1e9;
+    for (size_t i = 0; i < description.signals.size(); ++i) {
+        const SignalDescription& signal = description.signals[i];
+        double center = (signal.max + signal.min) / 2.0;
+        double amplitude = (signal.max - signal.min) / 2.0;
+        stream.values[i] = center + amplitude * std::sin(2 * 3.14159265358979 * stream.frequencies[i] * seconds);
+    }
+
+    Message::encode(description, stream.values.data(), frame);
+    frame.timestamp = stream.next;
+
+    stream.next += stream.period;
+    std::push_heap(heap.begin(), heap.end(), later);
+    return frame;
+}
+
+void CAN::SyntheticGenerator::fill(Frame* frames, size_t count) {
+    for (size_t i = 0; i < count; ++i) frames[i] = next();
+}
+
+uint64_t CAN::SyntheticGenerator::nextTime() const {
+    return heap.empty() ? UINT64_MAX : streams[heap.front()].next;
+}
+
+CAN::SimulatedDevice::SimulatedDevice(const Database& database)
+    : generator(database), start(std::chrono::steady_clock::now()),
+      origin(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count())) {
+
+}
+
+bool CAN::SimulatedDevice::receive(Frame& frame) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (generator.nextTime() > static_cast<uint64_t>(elapsed)) return false;
+
+    // Generator time counts from start, frames are stamped on the host clock like live devices
+    frame = generator.next();
+    frame.timestamp += origin;
+    return true;
+}
+
+bool CAN::SimulatedDevice::receive(Frame& frame, unsigned long timeout) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    uint64_t next = generator.nextTime();
+    auto due = next == UINT64_MAX ? deadline : start + std::chrono::nanoseconds(next);
+    std::this_thread::sleep_until(std::min(due, deadline));
+    return receive(frame);
+}
@@ -0,0 +1,441 @@
+#include "Transmit.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+static constexpr unsigned long SEND_TIMEOUT = 10; // ms
+
+void CAN::TransmitStatistics::record(double jitter) {
+    sent++;
+    meanJitter += (jitter - meanJitter) / static_cast<double>(sent);
+    maxJitter = std::max(maxJitter, jitter);
+}
+
+CAN::TransmitScheduler::TransmitScheduler() : start(std::chrono::steady_clock::now()) {
+
+}
+
+CAN::TransmitScheduler::~TransmitScheduler() {
+    stop();
+}
+
+int64_t CAN::TransmitScheduler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CAN::TransmitScheduler::insert(const Entry& entry) {
+    int64_t tick = std::max(entry.deadline / TICK, currentTick);
+    int64_t delta = tick - currentTick;
+
+    if (delta < (1 << LEVEL0_BITS)) {
+        level0[tick & ((1 << LEVEL0_BITS) - 1)].push_back(entry);
+    } else if (delta < (1 << (LEVEL0_BITS + LEVEL_BITS))) {
+        level1[(tick >> LEVEL0_BITS) & ((1 << LEVEL_BITS) - 1)].push_back(entry);
+    } else {
+        // Beyond the wheel's range the entry is parked in the furthest slot and re-cascaded
+        const int64_t range = 1 << (LEVEL0_BITS + 2 * LEVEL_BITS);
+        if (delta >= range) tick = currentTick + range - 1;
+        level2[(tick >> (LEVEL0_BITS + LEVEL_BITS)) & ((1 << LEVEL_BITS) - 1)].push_back(entry);
+    }
+    pending++;
+}
+
+void CAN::TransmitScheduler::schedule(const Entry& entry) {
+    // An empty wheel can jump straight to the present instead of cascading through idle time
+    if (pending == 0) currentTick = std::max(currentTick, now() / TICK);
+    insert(entry);
+    wake.notify_one();
+}
+
+void CAN::TransmitScheduler::cascade(std::vector<Entry>& slot) {
+    std::vector<Entry> entries;
+    entries.swap(slot);
+    pending -= entries.size();
+    for (const Entry& entry : entries) insert(entry);
+}
+
+int64_t CAN::TransmitScheduler::nextTick() const {
+    if (pending == 0) return -1;
+
+    // First occupied level 0 slot, or the next cascade (which may be the current tick)
+    int64_t wrap = (currentTick + (1 << LEVEL0_BITS) - 1) & ~static_cast<int64_t>((1 << LEVEL0_BITS) - 1);
+    for (int64_t tick = currentTick; tick < wrap; ++tick) {
+        if (!level0[tick & ((1 << LEVEL0_BITS) - 1)].empty()) return tick;
+    }
+    return wrap;
+}
+
+void CAN::TransmitScheduler::advance(int64_t tick, std::vector<Entry>& due) {
+    currentTick = tick;
+    if ((tick & ((1 << LEVEL0_BITS) - 1)) == 0) {
+        if ((tick & ((1 << (LEVEL0_BITS + LEVEL_BITS)) - 1)) == 0) {
+            cascade(level2[(tick >> (LEVEL0_BITS + LEVEL_BITS)) & ((1 << LEVEL_BITS) - 1)]);
+        }
+        cascade(level1[(tick >> LEVEL0_BITS) & ((1 << LEVEL_BITS) - 1)]);
+    }
+
+    std::vector<Entry>& slot = level0[tick & ((1 << LEVEL0_BITS) - 1)];
+    due.insert(due.end(), slot.begin(), slot.end());
+    pending -= slot.size();
+    slot.clear();
+    currentTick = tick + 1;
+}
+
+void CAN::TransmitScheduler::run() {
+    std::vector<Entry> due;
+    std::vector<Frame> frames;
+    std::vector<int> results;
+    std::vector<int64_t> sendTimes;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        int64_t tick = nextTick();
+        if (tick < 0) {
+            wake.wait(lock);
+            continue;
+        }
+
+        // Sleep until shortly before the deadline, new entries or stop() wake us early
+        int64_t remaining = tick * TICK - now();
+        if (remaining > SPIN_MARGIN) {
+            wake.wait_for(lock, std::chrono::nanoseconds(remaining - SPIN_MARGIN));
+            continue;
+        }
+
+        due.clear();
+        advance(tick, due);
+        std::sort(due.begin(), due.end(), [](const Entry& a, const Entry& b) { return a.deadline < b.deadline; });
+
+        // Encode under the lock, the jobs may change while we send
+        frames.clear();
+        for (auto it = due.begin(); it != due.end();) {
+            auto job = jobs.find(it->id);
+            if (job == jobs.end()) {
+                it = due.erase(it);
+                continue;
+            }
+            Frame frame;
+            Message::encode(job->second.message.description, job->second.message.values.data(), frame);
+            if (frame.isFD() && job->second.message.bitrateSwitch) frame.flags |= MSG_FLAG_BRS;
+            frames.push_back(frame);
+            ++it;
+        }
+        std::shared_ptr<Device> target = device;
+        lock.unlock();
+
+        results.assign(due.size(), CANAL_ERROR_NOT_OPEN);
+        sendTimes.assign(due.size(), 0);
+        for (size_t i = 0; i < due.size(); ++i) {
+            while (now() < due[i].deadline) std::this_thread::yield();
+            sendTimes[i] = now();
+            if (target) results[i] = target->send(frames[i], SEND_TIMEOUT);
+        }
+
+        lock.lock();
+        int64_t time = now();
+        for (size_t i = 0; i < due.size(); ++i) {
+            auto job = jobs.find(due[i].id);
+            if (job == jobs.end()) continue;
+            Job& j = job->second;
+
+            if (results[i] != CANAL_ERROR_SUCCESS) {
+                j.statistics.errors++;
+                total.errors++;
+            } else {
+                int64_t jitter = sendTimes[i] - due[i].deadline;
+                j.statistics.record(jitter / 1000.0);
+                total.record(jitter / 1000.0);
+                if (jitter > LATE_THRESHOLD) {
+                    j.statistics.late++;
+                    total.late++;
+                }
+            }
+
+            if (!due[i].periodic || j.message.cycleTime == 0) continue;
+            if (j.message.count > 0 && --j.remaining == 0) continue;
+
+            // Keep the phase, skipping whole cycles we can no longer make
+            Entry next = due[i];
+            int64_t cycle = static_cast<int64_t>(j.message.cycleTime) * 1000000;
+            next.deadline += cycle;
+            if (next.deadline < time) {
+                int64_t skipped = (time - next.deadline) / cycle + 1;
+                next.deadline += skipped * cycle;
+                j.statistics.missed += skipped;
+                total.missed += skipped;
+            }
+            insert(next);
+        }
+    }
+}
+
+void CAN::TransmitScheduler::setDevice(std::shared_ptr<Device> device) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->device = std::move(device);
+}
+
+int CAN::TransmitScheduler::add(const PeriodicMessage& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running) {
+        if (thread.joinable()) thread.join();
+#ifdef _WIN32
+        timeBeginPeriod(1);
+#endif
+        running = true;
+        thread = std::thread(&TransmitScheduler::run, this);
+    }
+
+    int id = nextID++;
+    jobs[id] = Job{message, message.count, {}};
+    if (message.cycleTime > 0) schedule({id, now() + static_cast<int64_t>(message.offset) * 1000000, true});
+    return id;
+}
+
+void CAN::TransmitScheduler::remove(int id) {
+    // Entries of removed jobs are dropped when they come due
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.erase(id);
+}
+
+void CAN::TransmitScheduler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.clear();
+}
+
+void CAN::TransmitScheduler::update(int id, const std::vector<double>& values) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    if (it == jobs.end()) return;
+
+    PeriodicMessage& message = it->second.message;
+    bool changed = message.values != values;
+    message.values = values;
+    if (changed && message.onChange) schedule({id, now(), false});
+}
+
+std::vector<int> CAN::TransmitScheduler::ids() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<int> result;
+    for (const auto& [id, job] : jobs) result.push_back(id);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+CAN::PeriodicMessage CAN::TransmitScheduler::message(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    if (it == jobs.end()) throw std::runtime_error("No periodic message with id " + std::to_string(id));
+    return it->second.message;
+}
+
+CAN::TransmitStatistics CAN::TransmitScheduler::statistics(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    return it != jobs.end() ? it->second.statistics : TransmitStatistics();
+}
+
+CAN::TransmitStatistics CAN::TransmitScheduler::statistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total;
+}
+
+void CAN::TransmitScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+        wake.notify_one();
+    }
+    thread.join();
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+// Value of count hex digits at pos, -1 if any is missing or not a hex digit
+static long hexValue(const std::string& text, size_t pos, size_t count) {
+    if (count == 0 || pos + count > text.size()) return -1;
+    long value = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        unsigned char digit = static_cast<unsigned char>(text[i]);
+        if (!std::isxdigit(digit)) return -1;
+        value = value * 16 + (std::isdigit(digit) ? digit - '0' : std::tolower(digit) - 'a' + 10);
+    }
+    return value;
+}
+
+std::vector<CAN::Frame> CAN::loadFrames(const std::string& filename) {
+    std::vector<Frame> frames;
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("Could not open frame file: " + filename);
+
+    std::string line;
+    size_t number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        auto invalid = [&](const std::string& what) {
+            return std::runtime_error(filename + ":" + std::to_string(number) + ": " + what);
+        };
+
+        // Blank lines and lines starting with '#' or ';' are comments
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#' || line[first] == ';') continue;
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+
+        // Skip candump's "(timestamp) interface" prefix if present
+        size_t hash = line.find('#');
+        if (hash == std::string::npos) throw invalid("missing '#' after the id");
+        size_t begin = line.find_last_of(' ', hash);
+        begin = begin == std::string::npos ? 0 : begin + 1;
+
+        Frame frame;
+        size_t idLength = hash - begin;
+        if (idLength > 8 || hexValue(line, begin, idLength) < 0) throw invalid("invalid id");
+        frame.id = static_cast<unsigned long>(hexValue(line, begin, idLength));
+        if (idLength > 3) frame.flags |= MSG_FLAG_EXTENDED;
+
+        size_t pos = hash + 1;
+        if (pos < line.size() && line[pos] == '#') {
+            // FD frame, followed by a flags nibble
+            frame.flags |= MSG_FLAG_FD;
+            long fdFlags = hexValue(line, pos + 1, 1);
+            if (fdFlags < 0) throw invalid("invalid FD flags");
+            if (fdFlags & 1) frame.flags |= MSG_FLAG_BRS;
+            if (fdFlags & 2) frame.flags |= MSG_FLAG_ESI;
+            pos += 2;
+        } else if (pos < line.size() && line[pos] == 'R') {
+            frame.flags |= MSG_FLAG_RTR;
+            frames.push_back(frame);
+            continue;
+        }
+
+        size_t maxLength = frame.isFD() ? MAX_DATA_LENGTH : CLASSIC_DATA_LENGTH;
+        while (pos < line.size()) {
+            if (line[pos] == '.') {
+                pos++;
+                continue;
+            }
+            long byte = hexValue(line, pos, 2);
+            if (byte < 0) throw invalid("invalid data byte");
+            if (frame.sizeData == maxLength) throw invalid("more than " + std::to_string(maxLength) + " data bytes");
+            frame.data[frame.sizeData++] = static_cast<uint8_t>(byte);
+            pos += 2;
+        }
+        frames.push_back(frame);
+    }
+
+    return frames;
+}
+
+std::vector<CAN::Frame> CAN::generateFrames(unsigned long id, size_t count, size_t length, bool bitrateSwitch) {
+    std::vector<Frame> frames(count);
+    length = fdLength(std::min<size_t>(length, MAX_DATA_LENGTH));
+
+    for (size_t i = 0; i < count; ++i) {
+        Frame& frame = frames[i];
+        frame.id = id;
+        if (id > 0x7FF) frame.flags |= MSG_FLAG_EXTENDED;
+        if (length > CLASSIC_DATA_LENGTH) frame.flags |= MSG_FLAG_FD | (bitrateSwitch ? MSG_FLAG_BRS : 0);
+        frame.sizeData = static_cast<unsigned char>(length);
+        for (size_t j = 0; j < length && j < sizeof(i); ++j) frame.data[j] = static_cast<uint8_t>(i >> (8 * j));
+    }
+
+    return frames;
+}
+
+CAN::BulkTransmitter::~BulkTransmitter() {
+    cancel();
+}
+
+void CAN::BulkTransmitter::setDevice(std::shared_ptr<Device> device) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->device = std::move(device);
+}
+
+void CAN::BulkTransmitter::setBitrate(unsigned long bitrate, unsigned long dataBitrate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->bitrate = bitrate;
+    this->dataBitrate = dataBitrate;
+}
+
+void CAN::BulkTransmitter::start(std::vector<Frame> frames) {
+    cancel();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    this->frames = std::move(frames);
+    stats = BulkStatistics();
+    stats.queued = this->frames.size();
+    stats.running = true;
+    cancelled = false;
+    thread = std::thread(&BulkTransmitter::run, this);
+}
+
+void CAN::BulkTransmitter::cancel() {
+    cancelled = true;
+    if (thread.joinable()) thread.join();
+}
+
+CAN::BulkStatistics CAN::BulkTransmitter::statistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void CAN::BulkTransmitter::run() {
+    const auto MIN_BACKOFF = std::chrono::microseconds(50);
+    const auto MAX_BACKOFF = std::chrono::microseconds(5000);
+
+    std::shared_ptr<Device> target;
+    unsigned long nominal, data;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        target = device;
+        nominal = bitrate;
+        data = dataBitrate;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    auto backoff = MIN_BACKOFF;
+    size_t next = 0;
+    int error = target ? CANAL_ERROR_SUCCESS : CANAL_ERROR_NOT_OPEN;
+
+    while (!cancelled && target && next < frames.size()) {
+        size_t count = std::min(BATCH, frames.size() - next);
+        size_t sent = target->sendBatch(&frames[next], count, error);
+
+        double busTime = 0;
+        for (size_t i = next; i < next + sent; ++i) busTime += frameTime(frames[i], nominal, data);
+        next += sent;
+
+        bool full = error == CANAL_ERROR_FIFO_FULL || error == CANAL_ERROR_TRM_FULL;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.sent = next;
+            stats.busTime += busTime;
+            stats.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            if (full) stats.retries++;
+        }
+
+        if (error == CANAL_ERROR_SUCCESS) {
+            backoff = MIN_BACKOFF;
+        } else if (full) {
+            // Give the device time to drain, backing off further while it stays full
+            std::this_thread::sleep_for(backoff);
+            backoff = sent > 0 ? MIN_BACKOFF : std::min(backoff * 2, MAX_BACKOFF);
+            error = CANAL_ERROR_SUCCESS;
+        } else {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.error = error;
+    stats.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stats.running = false;
+}
@@ -0,0 +1,95 @@
+#include "Trigger.h"
+
+#include <algorithm>
+
+CAN::TriggerCapture::TriggerCapture(const std::string& basename, const Filter& trigger, const TriggerOptions& options)
+    : basename(basename), trigger(trigger), options(options), ring(std::max<size_t>(options.ringFrames, 1)) {}
+
+bool CAN::TriggerCapture::fired(const Frame& frame) {
+    bool match = trigger.matches(frame);
+
+    // Error frames carry no id worth tracking, every one of them is an edge
+    if (frame.flags & MSG_FLAG_ERROR) return match;
+
+    // Channels interleave, the same id on two buses has its own edge
+    uint64_t key = frame.id | (static_cast<uint64_t>(frame.flags & MSG_FLAG_EXTENDED) << 32) | (static_cast<uint64_t>(frame.obid) << 33);
+    bool& last = lastMatch[key];
+    bool edge = match && !last;
+    last = match;
+    return edge;
+}
+
+void CAN::TriggerCapture::push(const Frame& frame) {
+    // Drop frames that fell out of the pre-trigger window, then the oldest if the ring is full. Batches of
+    // several channels arrive out of timestamp order, a frame older than the head drops nothing.
+    while (count > 0 && frame.timestamp > ring[head].timestamp && frame.timestamp - ring[head].timestamp > options.preTrigger) {
+        head = (head + 1) % ring.size();
+        count--;
+    }
+    if (count == ring.size()) {
+        head = (head + 1) % ring.size();
+        count--;
+    }
+
+    ring[(head + count) % ring.size()] = frame;
+    count++;
+}
+
+void CAN::TriggerCapture::start(const Frame& frame) {
+    writer = std::make_unique<LogWriter>(basename + "_trigger" + std::to_string(triggers));
+    files.push_back(writer->currentFile());
+    triggers++;
+
+    for (size_t i = 0; i < count; ++i) writer->write(ring[(head + i) % ring.size()]);
+    writer->write(frame);
+
+    // Frames of this capture go straight to its file, the next pre-trigger window starts empty
+    head = 0;
+    count = 0;
+
+    state = CAPTURING;
+    triggerTime = frame.timestamp;
+}
+
+void CAN::TriggerCapture::finish(uint64_t now) {
+    writer->flush();
+    writer.reset();
+    bool limit = options.maxTriggers > 0 && triggers >= options.maxTriggers;
+    state = options.policy == TRIGGER_SINGLE || limit ? DONE : HOLDOFF;
+    stateStart = now;
+}
+
+void CAN::TriggerCapture::add(const Frame& frame) {
+    if (state == DONE) return;
+
+    // Edges are tracked in every state so a level that is still true after holdoff does not fire again
+    bool edge = fired(frame);
+
+    if (state == CAPTURING) {
+        if (edge && options.policy == TRIGGER_RETRIGGER) triggerTime = std::max(triggerTime, frame.timestamp);
+
+        // Frames older than the trigger are inside the window
+        if (frame.timestamp <= triggerTime || frame.timestamp - triggerTime <= options.postTrigger) {
+            writer->write(frame);
+            return;
+        }
+        finish(frame.timestamp);
+    }
+
+    if (state == HOLDOFF && frame.timestamp >= stateStart && frame.timestamp - stateStart >= options.holdoff) state = ARMED;
+
+    if (state == ARMED && edge) {
+        start(frame);
+        return;
+    }
+
+    push(frame);
+}
+
+void CAN::TriggerCapture::add(const Frame* frames, size_t count) {
+    for (size_t i = 0; i < count; ++i) add(frames[i]);
+}
+
+void CAN::TriggerCapture::flush() {
+    if (state == CAPTURING) finish(triggerTime + options.postTrigger);
+}
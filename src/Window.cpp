@@ -10,9 +10,17 @@
 #include "usb2can.h"
 #include <string>
 #include "globals.h"
+#include "Synthetic.h"
+#include "Profiler.h"
+#include "Log.h"
+#include "Spectrum.h"
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
 #undef UNICODE
 #include <windows.h>
 #include <commdlg.h>
@@ -47,6 +55,7 @@ Window::~Window() {
 }
 
 void Window::update() {
+    PROFILE_SCOPE("window/update");
     glfwPollEvents();
 
     // Start ImGui frame
@@ -58,15 +67,20 @@ void Window::update() {
     glfwGetFramebufferSize(pWindow, &width, &height);
 
     createImGui();
+    if (showProfiler) createProfilerOverlay();
 
     // Render ImGui
-    ImGui::Render();
-    glViewport(0, 0, width, height);
-    glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-    glfwSwapBuffers(pWindow);
+    {
+        PROFILE_SCOPE("window/render");
+        ImGui::Render();
+        glViewport(0, 0, width, height);
+        glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+        glfwSwapBuffers(pWindow);
+    }
+    Profiler::markPaint();
 }
 
 void Window::close() {
@@ -101,6 +115,7 @@ void Window::createImGui() {
         if (ImGui::BeginTabItem("Transmit")) createTransmitTab();
         if (ImGui::BeginTabItem("Monitor")) createMonitorTab();
         if (ImGui::BeginTabItem("Graph View")) createGraphTab();
+        if (ImGui::BeginTabItem("Statistics")) createStatisticsTab();
 
         ImGui::EndTabBar();
     }
@@ -112,20 +127,68 @@ void Window::createImGui() {
     ImGui::SameLine();
 
     // Get the button size
-    float buttonWidth = ImGui::CalcTextSize(isPaused ? "Record" : "Stop").x;
+    float buttonWidth = ImGui::CalcTextSize(isPaused ? "Resume" : "Pause").x;
     float rightAlignPadding = 8.0f;
 
     // Align the button to the right
     ImGui::SetCursorPos(ImVec2(ImGui::GetWindowContentRegionMax().x - buttonWidth - rightAlignPadding, tabBarY));
 
-    if (ImGui::Button(isPaused ? "Record" : "Stop")) {
-        isPaused = !isPaused; // Toggle the pause state
+    // Frames keep arriving while paused, the views stay at the frames received up to the pause
+    if (ImGui::Button(isPaused ? "Resume" : "Pause")) {
+        isPaused = !isPaused;
+        if (isPaused) pausedSequence = messageBuffer.getSequence();
+    }
+
+    // F3 toggles the profiler overlay
+    if (ImGui::IsKeyPressed(ImGuiKey_F3, false)) {
+        showProfiler = !showProfiler;
+        Profiler::setEnabled(showProfiler);
+    }
+
+    ImGui::End();
+}
+
+void Window::createProfilerOverlay() {
+    ImGui::SetNextWindowPos(ImVec2(static_cast<float>(width) - 10.0f, 40.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.8f);
+
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                             ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+    if (!ImGui::Begin("Profiler", nullptr, flags)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+    if (ImGui::BeginTable("Timers", 5, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthFixed, 170);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed, 70);
+        ImGui::TableSetupColumn("p50 (us)", ImGuiTableColumnFlags_WidthFixed, 70);
+        ImGui::TableSetupColumn("p99 (us)", ImGuiTableColumnFlags_WidthFixed, 70);
+        ImGui::TableSetupColumn("Max (us)", ImGuiTableColumnFlags_WidthFixed, 70);
+        ImGui::TableHeadersRow();
+
+        for (const Profiler::Statistics& statistics : Profiler::statistics()) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(statistics.name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu", static_cast<unsigned long long>(statistics.count));
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", statistics.p50);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.1f", statistics.p99);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.1f", statistics.max);
+        }
+        ImGui::EndTable();
     }
 
     ImGui::End();
 }
 
 void Window::createSettingsTab() {
+    PROFILE_SCOPE("tab/settings");
     ImGui::Text("Device ID:");
     ImGui::SameLine(115);
     ImGui::Text("Baudrate:");
@@ -155,27 +218,154 @@ void Window::createSettingsTab() {
     if (ImGui::Button("Connect")) {
         std::string configStr = (std::string)deviceID + ";" + std::to_string(baudrate);
 
-        handle = CanalOpen(configStr.c_str(), 0x00000000);
-        if (handle <= 0) connectInfo = "CAN Channel not found! ERROR: " + std::to_string(handle);
-        else connectInfo = "Connected!";
+        try {
+            device.reset();
+            device = std::make_shared<CAN::CanalDevice>(configStr, 0x00000000);
+            transmitScheduler.setDevice(device);
+            bulkTransmitter.setDevice(device);
+            bulkTransmitter.setBitrate(baudrate * 1000UL, baudrate * 1000UL);
+            if (!filterTags) device->setFilters(ingestFilter.getIDFilters());
+            busStatistics.clear();
+            busBitrate = busDataBitrate = baudrate * 1000UL;
+            connectInfo = "Connected!";
+        } catch (const std::runtime_error& e) {
+            connectInfo = e.what();
+        }
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Simulate")) {
+        // Plays synthetic traffic for the loaded database, or for a generated one if none is loaded
+        if (messageDatabase.snapshot()->empty()) messageDatabase.publish(CAN::syntheticDatabase(CAN::SyntheticOptions()));
+        CAN::DatabaseSnapshot database = messageDatabase.snapshot();
+        device.reset();
+        device = std::make_shared<CAN::SimulatedDevice>(*database);
+        transmitScheduler.setDevice(device);
+        bulkTransmitter.setDevice(device);
+        busStatistics.clear();
+        connectInfo = "Simulating " + std::to_string(database->size()) + " messages";
     }
 
     ImGui::SameLine();
 
     ImGui::Text("%s", connectInfo.c_str());
 
+    ImGui::SeparatorText("Memory");
+    ImGui::SetNextItemWidth(100);
+    if (ImGui::InputInt("Budget (MB)", &bufferBudget, 64, 256, ImGuiInputTextFlags_EnterReturnsTrue)) {
+        bufferBudget = std::max(bufferBudget, 16);
+        messageBuffer.setBudget(static_cast<size_t>(bufferBudget) << 20);
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    if (ImGui::InputInt("Decode threads", &decodeThreads, 1, 1, ImGuiInputTextFlags_EnterReturnsTrue)) {
+        decodeThreads = std::clamp(decodeThreads, 1, 64);
+        messageBuffer.setDecodeThreads(static_cast<size_t>(decodeThreads));
+    }
+
+    static std::string spillInfo;
+    bool spillChanged = ImGui::Checkbox("Spill to disk", &spillEnabled);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200);
+    spillChanged |= ImGui::InputText("##SpillDirectory", &spillDirectory, ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100);
+    spillChanged |= ImGui::InputInt("Disk budget (GB)", &spillBudget, 1, 10, ImGuiInputTextFlags_EnterReturnsTrue);
+    if (spillChanged) {
+        spillBudget = std::max(spillBudget, 1);
+        try {
+            messageBuffer.setSpill(spillEnabled ? spillDirectory : "", static_cast<uint64_t>(spillBudget) << 30);
+            spillInfo = "";
+        } catch (const std::runtime_error& e) {
+            spillEnabled = false;
+            spillInfo = e.what();
+        }
+    }
+    if (spillEnabled && !messageBuffer.isSpilling()) {
+        spillEnabled = false;
+        spillInfo = "Spilling stopped: " + messageBuffer.getSpillError();
+    }
+    if (!spillInfo.empty()) ImGui::Text("%s", spillInfo.c_str());
+
+    CAN::MemoryUsage usage = messageBuffer.memoryUsage();
+    if (ImGui::BeginTable("Memory", 2, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Store", ImGuiTableColumnFlags_WidthFixed, 150);
+        ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_WidthFixed, 100);
+        ImGui::TableHeadersRow();
+
+        const std::pair<const char*, size_t> rows[] = {
+            {"Frames", usage.frames}, {"Payload", usage.payload}, {"Decoded columns", usage.columns},
+            {"Index", usage.index}, {"Signal names", usage.strings}, {"Segment cache", usage.cache},
+            {"Math channels", usage.derived}, {"Total", usage.total()},
+        };
+        for (const auto& [name, bytes] : rows) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", name);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.1f", bytes / 1048576.0);
+        }
+        ImGui::EndTable();
+    }
+
+    size_t frames = messageBuffer.size();
+    ImGui::Text("%zu frames held, %.0f bytes per frame, %llu dropped", frames, frames ? static_cast<double>(usage.total()) / frames : 0.0,
+                static_cast<unsigned long long>(messageBuffer.getEvicted()));
+    if (messageBuffer.isSpilling()) {
+        ImGui::Text("%zu frames on disk in %.1f MB", messageBuffer.getSpilledFrames(), messageBuffer.getSpilledBytes() / 1048576.0);
+    }
+    if (frames > 0) {
+        ImGui::Text("Covers %.6f s to %.6f s", messageBuffer.frame(0).timestamp / 1e9, messageBuffer.frame(frames - 1).timestamp / 1e9);
+    }
+
+    static std::string exportInfo;
+    // Seconds on the frame timeline
+    static double exportFromSeconds = 0.0, exportToSeconds = 1e9;
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputDouble("From (s)##Export", &exportFromSeconds, 0.0, 0.0, "%.6f");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(150);
+    ImGui::InputDouble("To (s)##Export", &exportToSeconds, 0.0, 0.0, "%.6f");
+    ImGui::SameLine();
+    if (ImGui::Button("Export log") && frames > 0) {
+        // Spilled segments are read back one at a time through the cache
+        try {
+            uint64_t exportFrom = exportFromSeconds > 0 ? static_cast<uint64_t>(exportFromSeconds * 1e9) : 0;
+            uint64_t exportTo = exportToSeconds < 1.8e10 ? static_cast<uint64_t>(std::max(exportToSeconds, 0.0) * 1e9) : UINT64_MAX;
+            CAN::LogWriter writer("export");
+            CAN::MessageBuffer::Span span = messageBuffer.range(exportFrom, exportTo);
+            for (size_t i = span.begin; i < span.end; ++i) {
+                CAN::Frame frame = messageBuffer.frame(i);
+                if (frame.timestamp >= exportFrom && frame.timestamp <= exportTo) writer.write(frame);
+            }
+            writer.flush();
+            exportInfo = "Exported " + std::to_string(writer.framesWritten()) + " frames to " + writer.currentFile();
+        } catch (const std::runtime_error& e) {
+            exportInfo = e.what();
+        }
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", exportInfo.c_str());
+
     ImGui::EndTabItem();
 }
 
 void Window::createTransmitTab() {
-    static CAN::MessageDescription* selectedMessageDes = nullptr;
-    static std::vector<float> signals;
+    PROFILE_SCOPE("tab/transmit");
+    // Selected by id, the description is looked up in this frame's snapshot
+    static int selectedID = -1;
+    static std::vector<double> signals;
+    CAN::DatabaseSnapshot database = messageDatabase.snapshot();
+    auto selected = database->find(selectedID);
+    const CAN::MessageDescription* selectedMessageDes = selected != database->end() ? &selected->second : nullptr;
+    if (selectedMessageDes && signals.size() != selectedMessageDes->signals.size()) signals.resize(selectedMessageDes->signals.size(), 0);
 
     ImGui::SetNextItemWidth(150);
     if (ImGui::BeginCombo("##DropdownMessageType", selectedMessageDes ? selectedMessageDes->name.c_str() : "")) {
-        for (auto& [key, md] : messageDescriptions) {
+        for (const auto& [key, md] : *database) {
             bool is_selected = (&md == selectedMessageDes);
             if (ImGui::Selectable(md.name.c_str(), is_selected)) {
+                selectedID = key;
                 selectedMessageDes = &md;
                 signals.clear();
                 signals.resize(md.signals.size(), 0);
@@ -187,19 +377,39 @@ void Window::createTransmitTab() {
         ImGui::EndCombo();
     }
 
+    static bool bitrateSwitch = false;
+    ImGui::SameLine();
+    ImGui::Checkbox("BRS", &bitrateSwitch);
+
     ImGui::SameLine();
-    if (ImGui::Button("Send")) {
+    if (ImGui::Button("Send") && selectedMessageDes && device) {
         static unsigned long count = 0;
 
-        CANALMSG msg;
-        msg.data;
-        msg.flags = 0;
-        msg.id = selectedMessageDes->id;
-        msg.obid = 0;
-        msg.sizeData = selectedMessageDes->length;
-        msg.timestamp = count++;
-        
-        CanalSend(handle, &msg);
+        CAN::Frame frame;
+        CAN::Message::encode(*selectedMessageDes, signals.data(), frame);
+        if (frame.isFD() && bitrateSwitch) frame.flags |= MSG_FLAG_BRS;
+        frame.timestamp = count++;
+
+        device->send(frame);
+    }
+
+    static CAN::PeriodicMessage periodic;
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputScalar("Cycle (ms)", ImGuiDataType_U32, (void*)&periodic.cycleTime);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputScalar("Offset (ms)", ImGuiDataType_U32, (void*)&periodic.offset);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputScalar("Count", ImGuiDataType_U32, (void*)&periodic.count);
+    ImGui::SameLine();
+    ImGui::Checkbox("On change", &periodic.onChange);
+    ImGui::SameLine();
+    if (ImGui::Button("Add Periodic") && selectedMessageDes) {
+        periodic.description = *selectedMessageDes;
+        periodic.values = signals;
+        periodic.bitrateSwitch = bitrateSwitch;
+        transmitScheduler.add(periodic);
     }
 
     if (selectedMessageDes) {
@@ -207,10 +417,114 @@ void Window::createTransmitTab() {
         for (int i = 0; i < selectedMessageDes->signals.size(); i++) {
             const CAN::SignalDescription& signalDes = selectedMessageDes->signals[i];
             ImGui::SetNextItemWidth(100);
-            ImGui::InputFloat(signalDes.name.c_str(), &signals[i]);
+            ImGui::InputDouble(signalDes.name.c_str(), &signals[i]);
         }
     }
 
+    CAN::TransmitStatistics total = transmitScheduler.statistics();
+    ImGui::Text("Sent: %llu  Late: %llu  Missed: %llu  Errors: %llu  Jitter: %.1f us (max %.1f us)",
+                (unsigned long long)total.sent, (unsigned long long)total.late, (unsigned long long)total.missed,
+                (unsigned long long)total.errors, total.meanJitter, total.maxJitter);
+
+    if (ImGui::BeginTable("Periodic", 9, ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 150);
+        ImGui::TableSetupColumn("Cycle", ImGuiTableColumnFlags_WidthFixed, 50);
+        ImGui::TableSetupColumn("Sent", ImGuiTableColumnFlags_WidthFixed, 80);
+        ImGui::TableSetupColumn("Late", ImGuiTableColumnFlags_WidthFixed, 50);
+        ImGui::TableSetupColumn("Missed", ImGuiTableColumnFlags_WidthFixed, 50);
+        ImGui::TableSetupColumn("Errors", ImGuiTableColumnFlags_WidthFixed, 50);
+        ImGui::TableSetupColumn("Jitter (us)", ImGuiTableColumnFlags_WidthFixed, 80);
+        ImGui::TableSetupColumn("Max (us)", ImGuiTableColumnFlags_WidthFixed, 80);
+        ImGui::TableSetupColumn("");
+        ImGui::TableHeadersRow();
+
+        for (int id : transmitScheduler.ids()) {
+            CAN::PeriodicMessage message = transmitScheduler.message(id);
+            CAN::TransmitStatistics statistics = transmitScheduler.statistics(id);
+
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", message.description.name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%lu", message.cycleTime);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%llu", (unsigned long long)statistics.sent);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%llu", (unsigned long long)statistics.late);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%llu", (unsigned long long)statistics.missed);
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%llu", (unsigned long long)statistics.errors);
+            ImGui::TableSetColumnIndex(6);
+            ImGui::Text("%.1f", statistics.meanJitter);
+            ImGui::TableSetColumnIndex(7);
+            ImGui::Text("%.1f", statistics.maxJitter);
+            ImGui::TableSetColumnIndex(8);
+            if (selectedMessageDes && selectedMessageDes->id == message.description.id) {
+                if (ImGui::SmallButton(("Update##" + std::to_string(id)).c_str())) transmitScheduler.update(id, signals);
+                ImGui::SameLine();
+            }
+            if (ImGui::SmallButton(("Remove##" + std::to_string(id)).c_str())) transmitScheduler.remove(id);
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Bulk Transmit");
+
+    static std::vector<CAN::Frame> bulkFrames;
+    static std::string bulkSource = "";
+    static std::string bulkLoadInfo = "";
+    if (ImGui::Button("Load Frames")) {
+        std::string file = openFileDialog("Frame Logs\0*.log;*.txt\0All Files\0*.*\0");
+        if (!file.empty()) {
+            try {
+                bulkFrames = CAN::loadFrames(file);
+                bulkSource = file;
+                bulkLoadInfo = "";
+            } catch (const std::runtime_error& e) {
+                bulkLoadInfo = e.what();
+            }
+        }
+    }
+
+    static int generateID = 0x100;
+    static int generateCount = 10000;
+    static int generateLength = 8;
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputScalar("ID##bulk", ImGuiDataType_U32, (void*)&generateID, nullptr, nullptr, "%02X", ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputScalar("Frames##bulk", ImGuiDataType_U32, (void*)&generateCount);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(80);
+    ImGui::InputScalar("Length##bulk", ImGuiDataType_U32, (void*)&generateLength);
+    ImGui::SameLine();
+    if (ImGui::Button("Generate")) {
+        bulkFrames = CAN::generateFrames(generateID, generateCount, generateLength, bitrateSwitch);
+        bulkSource = "generated";
+        bulkLoadInfo = "";
+    }
+    if (!bulkLoadInfo.empty()) ImGui::Text("%s", bulkLoadInfo.c_str());
+
+    CAN::BulkStatistics bulk = bulkTransmitter.statistics();
+    ImGui::Text("%zu frames (%s)", bulkFrames.size(), bulkSource.c_str());
+    ImGui::SameLine();
+    if (bulk.running) {
+        if (ImGui::Button("Cancel")) bulkTransmitter.cancel();
+    } else if (ImGui::Button("Start") && !bulkFrames.empty()) {
+        bulkTransmitter.start(bulkFrames);
+    }
+
+    if (bulk.queued > 0) {
+        ImGui::ProgressBar(static_cast<float>(bulk.sent) / bulk.queued, ImVec2(400, 0));
+        ImGui::Text("Sent: %zu/%zu  %.0f frames/s  Bus load: %.1f%%  Retries: %llu%s", bulk.sent, bulk.queued,
+                    bulk.framesPerSecond(), bulk.busLoad() * 100, (unsigned long long)bulk.retries,
+                    bulk.error != CANAL_ERROR_SUCCESS ? ("  ERROR: " + std::to_string(bulk.error)).c_str() : "");
+    }
+
     ImGui::EndTabItem();
 }
 
@@ -225,6 +539,7 @@ static std::string int_to_hex( T i , const int digits, bool add0x = true)
 }
 
 void Window::createDatabaseTab() {
+    PROFILE_SCOPE("tab/database");
     ImGui::Text("ID:");
     ImGui::SameLine(117);
     ImGui::Text("Name:");
@@ -252,8 +567,13 @@ void Window::createDatabaseTab() {
     ImGui::InputText("##messageSender", messageSender, IM_ARRAYSIZE(messageSender));
     ImGui::SameLine();
 
-    static CAN::MessageDescription* selectedDescription = nullptr;
+    // Edits are published as new snapshots, the selection is kept by id
+    static int selectedID = -1;
+    CAN::DatabaseSnapshot database = messageDatabase.snapshot();
+    auto selected = database->find(selectedID);
+    const CAN::MessageDescription* selectedDescription = selected != database->end() ? &selected->second : nullptr;
     if ((ImGui::IsMouseClicked(0) && !ImGui::IsAnyItemHovered()) || ImGui::IsKeyPressed(ImGuiKey_Escape)) {
+        selectedID = -1;
         selectedDescription = nullptr;
         messageID = 0;
         strcpy_s(messageName, "");
@@ -263,26 +583,25 @@ void Window::createDatabaseTab() {
 
     if (ImGui::Button("Save")) {
         CAN::MessageDescription messageDescription;
-        if (selectedDescription) {
-            messageDescription = *selectedDescription;
-
-            if (messageID != selectedDescription->id) {
-                messageDescriptions.erase(selectedDescription->id);
-            }
-        }
+        if (selectedDescription) messageDescription = *selectedDescription;
 
         messageDescription.id = messageID;
         messageDescription.name = messageName;
         messageDescription.length = messageLength;
         messageDescription.sender = messageSender;
 
-        messageDescriptions[messageID] = messageDescription;
-        selectedDescription = &messageDescriptions[messageID];
+        messageDatabase.update([&](CAN::Database& edited) {
+            if (selectedID >= 0 && messageID != selectedID) edited.erase(selectedID);
+            edited[messageID] = messageDescription;
+        });
+        // The old snapshot and selectedDescription stay valid until the end of this frame
+        selectedID = messageID;
     }
     ImGui::SameLine();
     if (ImGui::Button("Delete")) {
         if (selectedDescription) {
-            messageDescriptions.erase(selectedDescription->id);
+            messageDatabase.update([&](CAN::Database& edited) { edited.erase(selectedID); });
+            selectedID = -1;
             selectedDescription = nullptr;
         }
     }
@@ -294,7 +613,7 @@ void Window::createDatabaseTab() {
     static std::string dbcFile = "";
     if (ImGui::Button(buttonText.c_str())) {
         dbcFile = openFileDialog();
-        if (!dbcFile.empty()) CAN::parseDBC(dbcFile, messageDescriptions);
+        if (!dbcFile.empty()) messageDatabase.update([&](CAN::Database& edited) { CAN::parseDBC(dbcFile, edited); });
     }
 
 
@@ -309,13 +628,14 @@ void Window::createDatabaseTab() {
         // ImGui::TableSetupColumn("Signals");
         ImGui::TableHeadersRow(); // Optional: Adds a header row with column names
 
-        for (auto& pair : messageDescriptions) {
-            CAN::MessageDescription& message = pair.second;
+        for (const auto& pair : *database) {
+            const CAN::MessageDescription& message = pair.second;
             ImGui::TableNextRow();
             ImGui::TableSetColumnIndex(0);
             ImGui::Text("%s", int_to_hex(message.id, 2).c_str());
             ImGui::SameLine();
-            if (ImGui::Selectable(("##" + std::to_string(message.id)).c_str(), selectedDescription == &message, ImGuiSelectableFlags_SpanAllColumns)) {
+            if (ImGui::Selectable(("##" + std::to_string(message.id)).c_str(), selectedID == message.id, ImGuiSelectableFlags_SpanAllColumns)) {
+                selectedID = message.id;
                 selectedDescription = &message;
 
                 messageID = message.id;
@@ -360,23 +680,34 @@ void Window::createDatabaseTab() {
             float columnWidth;
             // ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0, 0, 0, 0)); // Transparent background
             // ImGui::PushStyleColor(ImGuiCol_FrameBgHovered, ImVec4(0, 0, 0, 0)); // Transparent when hovered
-            for (CAN::SignalDescription& signal : selectedDescription->signals) {
+            // Each signal is edited as a copy and published when it changed
+            for (size_t i = 0; i < selectedDescription->signals.size(); ++i) {
+                CAN::SignalDescription signal = selectedDescription->signals[i];
+                bool changed = false;
                 ImGui::TableNextRow();
 
                 ImGui::TableSetColumnIndex(0);
                 columnWidth = ImGui::GetColumnWidth();
                 ImGui::SetNextItemWidth(columnWidth);
-                ImGui::InputText(("##signalName" + std::to_string((size_t)&signal)).c_str(), &signal.name);
+                changed |= ImGui::InputText(("##signalName" + std::to_string(i)).c_str(), &signal.name);
 
                 ImGui::TableSetColumnIndex(1);
                 columnWidth = ImGui::GetColumnWidth();
                 ImGui::SetNextItemWidth(100);
-                ImGui::InputScalar(("##startBit" + std::to_string((size_t)&signal)).c_str(), ImGuiDataType_U8, (void*)&signal.startBit, (void*)&step, (void*)&stepFast);
+                changed |= ImGui::InputScalar(("##startBit" + std::to_string(i)).c_str(), ImGuiDataType_U8, (void*)&signal.startBit, (void*)&step, (void*)&stepFast);
 
                 ImGui::TableSetColumnIndex(2);
                 columnWidth = ImGui::GetColumnWidth();
                 ImGui::SetNextItemWidth(100);
-                ImGui::InputScalar(("##length" + std::to_string((size_t)&signal)).c_str(), ImGuiDataType_U8, (void*)&signal.length, (void*)&step, (void*)&stepFast);
+                changed |= ImGui::InputScalar(("##length" + std::to_string(i)).c_str(), ImGuiDataType_U8, (void*)&signal.length, (void*)&step, (void*)&stepFast);
+
+                if (changed) {
+                    signal.compile();
+                    messageDatabase.update([&](CAN::Database& edited) {
+                        auto it = edited.find(selectedID);
+                        if (it != edited.end() && i < it->second.signals.size()) it->second.signals[i] = signal;
+                    });
+                }
                 // int min = 0;
                 // int max = 64;
                 // ImGui::DragScalar(("##startBit" + std::to_string((size_t)&signal)).c_str(),
@@ -414,56 +745,107 @@ void Window::createDatabaseTab() {
 }
 
 void Window::createMonitorTab() {
+    PROFILE_SCOPE("tab/monitor");
+    CAN::DatabaseSnapshot database = messageDatabase.snapshot();
+    static std::string filterText;
+    static std::string filterInfo;
+    static bool tagMatches = false;
+
+    ImGui::SetNextItemWidth(400);
+    bool apply = ImGui::InputTextWithHint("##Filter", "Filter, e.g. id in 0x100..0x1FF && data[0] > 0x80", &filterText, ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    ImGui::Checkbox("Tag only", &tagMatches);
+    ImGui::SameLine();
+    if (ImGui::Button("Apply") || apply) {
+        try {
+            ingestFilter = CAN::Filter(filterText, messageDatabase.snapshot().get());
+            filterTags = tagMatches;
+
+            // Dropping can start in the driver, tagging needs every frame
+            int error = CANAL_ERROR_NOT_SUPPORTED;
+            if (device) error = device->setFilters(filterTags ? std::vector<CAN::IDFilter>() : ingestFilter.getIDFilters());
+            filterInfo = ingestFilter.empty() ? "" : (error == CANAL_ERROR_SUCCESS && !filterTags && !ingestFilter.getIDFilters().empty() ? "Active, ids filtered by the device" : "Active");
+        } catch (const std::runtime_error& e) {
+            filterInfo = e.what();
+        }
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", filterInfo.c_str());
+
+    // Rows of the frames received up to the pause, or all of them
+    size_t frames = messageBuffer.sizeAt(isPaused ? pausedSequence : UINT64_MAX);
+    static double jumpSeconds = 0.0;
+    int jumpRow = -1;
+    ImGui::SetNextItemWidth(150);
+    bool jump = ImGui::InputDouble("##JumpTime", &jumpSeconds, 0.0, 0.0, "%.6f", ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::SameLine();
+    if ((ImGui::Button("Jump to time (s)") || jump) && frames > 0) {
+        uint64_t jumpTime = jumpSeconds > 0 ? static_cast<uint64_t>(jumpSeconds * 1e9) : 0;
+        jumpRow = static_cast<int>(std::min(messageBuffer.range(jumpTime, UINT64_MAX).begin, frames - 1));
+    }
+
     if (ImGui::BeginChild("ScrollableTable", ImVec2(0, 0), true, ImGuiWindowFlags_AlwaysVerticalScrollbar | ImGuiWindowFlags_NoBackground)) {
         if (ImGui::BeginTable("Monitor", 6, ImGuiTableFlags_RowBg)) {
             // Set up columns
             ImGui::TableSetupColumn("Timestamp", ImGuiTableColumnFlags_WidthFixed, 100);
             ImGui::TableSetupColumn("ID", ImGuiTableColumnFlags_WidthFixed, 50);
-            ImGui::TableSetupColumn("Flags", ImGuiTableColumnFlags_WidthFixed, 50);
+            ImGui::TableSetupColumn("Flags", ImGuiTableColumnFlags_WidthFixed, 80);
             ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 50);
-            ImGui::TableSetupColumn("Raw Data", ImGuiTableColumnFlags_WidthFixed, 200);
+            ImGui::TableSetupColumn("Raw Data", ImGuiTableColumnFlags_WidthFixed, 400);
             ImGui::TableSetupColumn("Data");
             ImGui::TableHeadersRow(); // Optional: Adds a header row with column names
 
-        // for (CAN::Message& message : messageBuffer.getMessages()) {
-        // const std::vector<CAN::Message>& messages = messageBuffer.getMessages();
-        // for (auto rit = messages.rbegin(); rit != messages.rend(); rit++) {
-        for (const CAN::Message& message : messageBuffer) {
-            // const CAN::Message& message = *rit;
-            ImGui::TableNextRow();
-            ImGui::TableSetColumnIndex(0);
-            ImGui::Text("%lu", message.timestamp);
-
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%s", int_to_hex(message.id, 2).c_str());
-
-                ImGui::TableSetColumnIndex(2);
-                ImGui::Text("%lu", message.flags);
-
-                ImGui::TableSetColumnIndex(3);
-                ImGui::Text("%i", message.sizeData);
-
-                ImGui::TableSetColumnIndex(4);
-                std::ostringstream oss;
-                for (size_t i = 0; i < message.rawData.size(); ++i) {
-                    oss << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << static_cast<int>(message.rawData[i]);
-                    if (i < message.rawData.size() - 1) {
-                        oss << " ";
+            // Only the visible rows are built, the buffer can hold millions
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(frames));
+            if (jumpRow >= 0) clipper.IncludeItemByIndex(jumpRow);
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    CAN::Frame frame = messageBuffer.frame(row);
+                    ImGui::TableNextRow();
+                    if (row == jumpRow) ImGui::SetScrollHereY(0.0f);
+                    if (frame.flags & MSG_FLAG_TAGGED) ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, IM_COL32(90, 70, 20, 255));
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("%.6f", frame.timestamp / 1e9);
+
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%s", int_to_hex(frame.id, 2).c_str());
+
+                    ImGui::TableSetColumnIndex(2);
+                    std::string flags = frame.flags & MSG_FLAG_ERROR ? "ERR" : (frame.flags & MSG_FLAG_FD ? "FD" : "");
+                    if (frame.flags & MSG_FLAG_BRS) flags += " BRS";
+                    if (frame.flags & MSG_FLAG_ESI) flags += " ESI";
+                    if (frame.flags & MSG_FLAG_EXTENDED) flags += " EXT";
+                    ImGui::Text("%s", flags.c_str());
+
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%i", frame.sizeData);
+
+                    ImGui::TableSetColumnIndex(4);
+                    std::ostringstream oss;
+                    for (size_t i = 0; i < frame.sizeData; ++i) {
+                        oss << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << static_cast<int>(frame.data[i]);
+                        if (i < frame.sizeData - 1u) {
+                            // FD payloads wrap every 16 bytes
+                            oss << ((i + 1) % 16 == 0 ? "\n" : " ");
+                        }
                     }
-                }
-                ImGui::Text("%s", oss.str().c_str());
-                
-                ImGui::TableSetColumnIndex(5);
-                auto it = messageDescriptions.find(message.id);
-                if (it != messageDescriptions.end()) {
-                    std::string signals = "";
-                    CAN::MessageDescription& description = it->second;
-                    for (CAN::SignalDescription& signal : description.signals) {
-                        signals += signal.name + ": " + std::to_string(message.getSignalValue<double>(signal.name)) + " " + signal.unit;
-                        if (&signal != &description.signals.back()) signals += "\t";
+                    ImGui::Text("%s", oss.str().c_str());
+
+                    ImGui::TableSetColumnIndex(5);
+                    auto it = database->find(frame.id);
+                    if (it != database->end()) {
+                        std::string signals = "";
+                        const CAN::MessageDescription& description = it->second;
+                        for (const CAN::SignalDescription& signal : description.signals) {
+                            double value = messageBuffer.value(row, signal.name);
+                            if (std::isnan(value)) continue;
+                            if (!signals.empty()) signals += "\t";
+                            signals += signal.name + ": " + std::to_string(value) + " " + signal.unit;
+                        }
+
+                        ImGui::Text("%s", signals.c_str());
                     }
-                    
-                    ImGui::Text("%s", signals.c_str());
                 }
             }
 
@@ -476,6 +858,9 @@ void Window::createMonitorTab() {
 }
 
 void Window::createGraphTab() {
+    PROFILE_SCOPE("tab/graph");
+    CAN::DatabaseSnapshot database = messageDatabase.snapshot();
+    uint64_t sequence = isPaused ? pausedSequence : UINT64_MAX;
     ImGui::Columns(2, "Columns");
     ImGui::SetColumnWidth(0, 200);
     static int dtGraph = 0;
@@ -490,15 +875,21 @@ void Window::createGraphTab() {
 
         // ImGui::TableHeadersRow(); // Optional: Header row
 
-        for (auto& pair : messageDescriptions) {
-            CAN::MessageDescription& message = pair.second;
+        for (const auto& pair : *database) {
+            const CAN::MessageDescription& message = pair.second;
             std::string label = int_to_hex(message.id, 2) + " " + message.name;
             if (label.find(search) == std::string::npos) continue;
             ImGui::TableNextRow();
             
             // Checkbox Column
             ImGui::TableSetColumnIndex(0);
-            ImGui::Checkbox(("##checkbox" + std::to_string(message.id)).c_str(), &message.plot);
+            bool plot = message.plot;
+            if (ImGui::Checkbox(("##checkbox" + std::to_string(message.id)).c_str(), &plot)) {
+                messageDatabase.update([&](CAN::Database& edited) {
+                    auto it = edited.find(message.id);
+                    if (it != edited.end()) it->second.plot = plot;
+                });
+            }
 
             // Text Column
             ImGui::TableSetColumnIndex(1);
@@ -508,30 +899,296 @@ void Window::createGraphTab() {
         ImGui::EndTable();
     }
 
+    // Math channels bind to this snapshot, edits to the database apply to channels added afterwards
+    ImGui::SeparatorText("Math channels");
+    static std::string channelName, channelExpression, channelInfo;
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    ImGui::InputTextWithHint("##channelName", "Name", &channelName);
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    bool addChannel = ImGui::InputTextWithHint("##channelExpression", "a - b, avg(a, 10), deriv(a)", &channelExpression, ImGuiInputTextFlags_EnterReturnsTrue);
+    if (ImGui::Button("Add") || addChannel) {
+        try {
+            mathChannels.emplace_back(channelName.empty() ? channelExpression : channelName, channelExpression, database.get());
+            channelInfo.clear();
+        } catch (const std::runtime_error& e) {
+            channelInfo = e.what();
+        }
+    }
+    if (!channelInfo.empty()) ImGui::Text("%s", channelInfo.c_str());
+    for (size_t i = 0; i < mathChannels.size(); ++i) {
+        if (ImGui::SmallButton(("x##channel" + std::to_string(i)).c_str())) {
+            mathChannels.erase(mathChannels.begin() + i);
+            break;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%s", mathChannels[i].getName().c_str());
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", mathChannels[i].getExpression().c_str());
+    }
+
+    // Spectrum of one signal over the window of its plot, the spectrogram follows its new samples
+    ImGui::SeparatorText("Spectrum");
+    static unsigned long spectrumID = 0;
+    static std::string spectrumSignal, spectrumInfo;
+    static int spectrumBits = 16;
+    static uint64_t spectrumFrom = 0, spectrumTo = UINT64_MAX; // Set while plotting the signal
+    static std::vector<double> spectrum;
+    static double spectrumRate = 0;
+    static std::unique_ptr<CAN::Spectrogram> spectrogram;
+    static uint64_t spectrogramFed = 0;
+
+    // Samples of the selected signal from t0 to t1 in time order, NaN and out of order samples left out
+    auto collect = [&](uint64_t t0, uint64_t t1, std::vector<uint64_t>& times, std::vector<double>& values) {
+        times.clear();
+        values.clear();
+        CAN::MessageBuffer::Series series = messageBuffer.series(spectrumID, spectrumSignal, sequence);
+        CAN::MessageBuffer::Span span = series.range(t0, t1);
+        for (size_t i = span.begin; i < span.end; ++i) {
+            uint64_t time = series.time(i);
+            double value = series.value(i);
+            if (time < t0 || time > t1 || std::isnan(value) || (!times.empty() && time <= times.back())) continue;
+            times.push_back(time);
+            values.push_back(value);
+        }
+    };
+    static std::vector<uint64_t> spectrumTimes;
+    static std::vector<double> spectrumValues;
+
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    if (ImGui::BeginCombo("##spectrumSignal", spectrumSignal.empty() ? "Signal of a plot" : spectrumSignal.c_str())) {
+        for (const auto& pair : *database) {
+            if (!pair.second.plot) continue;
+            for (const CAN::SignalDescription& signal : pair.second.signals) {
+                bool selected = spectrumID == pair.second.id && spectrumSignal == signal.name;
+                if (ImGui::Selectable((pair.second.name + "." + signal.name).c_str(), selected) && !selected) {
+                    spectrumID = pair.second.id;
+                    spectrumSignal = signal.name;
+                    spectrum.clear();
+                    spectrogram.reset();
+                }
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SetNextItemWidth(100);
+    ImGui::SliderInt("Size 2^n", &spectrumBits, 8, 20);
+
+    if (ImGui::Button("Compute") && !spectrumSignal.empty()) {
+        collect(spectrumFrom, spectrumTo, spectrumTimes, spectrumValues);
+        if (spectrumTimes.size() < 4) {
+            spectrumInfo = "Too few samples in the window";
+        } else {
+            // Uniform grid of the next power of two above the sample count, up to the chosen size
+            size_t size = 4;
+            while (size < spectrumTimes.size() && size < (size_t(1) << spectrumBits)) size *= 2;
+            // More samples than points are averaged over each step, so they do not alias
+            std::vector<double> uniform(size);
+            bool decimated = spectrumTimes.size() > size;
+            if (decimated) CAN::downsample(spectrumTimes.data(), spectrumValues.data(), spectrumTimes.size(), spectrumTimes.front(), spectrumTimes.back(), uniform.data(), size);
+            else CAN::resample(spectrumTimes.data(), spectrumValues.data(), spectrumTimes.size(), spectrumTimes.front(), spectrumTimes.back(), uniform.data(), size);
+            spectrumRate = (size - 1) / ((spectrumTimes.back() - spectrumTimes.front()) / 1e9);
+
+            CAN::FFT fft(size);
+            spectrum.resize(fft.bins());
+            fft.amplitudes(uniform.data(), spectrum.data());
+            spectrumInfo = std::to_string(spectrumTimes.size()) + " samples " + (decimated ? "averaged to " : "as ") + std::to_string(size) +
+                           " at " + std::to_string(static_cast<int>(spectrumRate)) + " Hz";
+        }
+    }
+    ImGui::SameLine();
+    bool live = spectrogram != nullptr;
+    if (ImGui::Checkbox("Spectrogram", &live) && !spectrumSignal.empty()) {
+        spectrogram.reset();
+        if (live) {
+            // Rate of the samples in the plot window, rows of up to 4096 samples
+            collect(spectrumFrom, spectrumTo, spectrumTimes, spectrumValues);
+            if (spectrumTimes.size() < 2) {
+                spectrumInfo = "Too few samples in the window";
+            } else {
+                double rate = (spectrumTimes.size() - 1) / ((spectrumTimes.back() - spectrumTimes.front()) / 1e9);
+                spectrogram = std::make_unique<CAN::Spectrogram>(size_t(1) << std::min(spectrumBits, 12), rate);
+                spectrogramFed = spectrumFrom;
+            }
+        }
+    }
+    if (spectrogram) {
+        // Samples since the last frame go to the worker
+        collect(spectrogramFed + 1, UINT64_MAX, spectrumTimes, spectrumValues);
+        if (!spectrumTimes.empty()) {
+            spectrogram->push(spectrumTimes.data(), spectrumValues.data(), spectrumTimes.size());
+            spectrogramFed = spectrumTimes.back();
+        }
+    }
+    if (!spectrumInfo.empty()) ImGui::Text("%s", spectrumInfo.c_str());
+
     ImGui::NextColumn();
+    static bool fitAll = true;
+    ImGui::Checkbox("Fit all", &fitAll);
     ImGui::BeginChild("ScrollablePlots", ImVec2(0, 0), true, ImGuiWindowFlags_NoBackground);
 
-    for (auto& pair : messageDescriptions) {
-        CAN::MessageDescription& messageDescription = pair.second;
-        if (messageDescription.plot) {
-            if (ImPlot::BeginPlot((int_to_hex(messageDescription.id, 2) + " " + messageDescription.name).c_str())) {
-                ImPlot::SetupAxes("Time (ms)", "", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_None);
-
-                for (CAN::SignalDescription& signal : messageDescription.signals) {
-                    auto dataGetter = [](int idx, void* data) -> ImPlotPoint {
-                        auto* info = static_cast<std::pair<std::string, const std::deque<CAN::Message*>*>*>(data);
-                        const CAN::Message* msg = (*info->second)[idx];
-                        messageBuffer.begin();
-                        return ImPlotPoint(msg->timestamp, msg->getSignalValue<double>(info->first));
-                    };
-
-                    const std::deque<CAN::Message*>& data = messageBuffer.ofID(messageDescription.id);
-                    std::pair<std::string, const std::deque<CAN::Message*>*> info = {signal.name, &data};
-                    ImPlot::PlotLineG(signal.name.c_str(), dataGetter, &info, static_cast<int>(data.size()));
+    // Visible part of a series
+    struct View {
+        const CAN::MessageBuffer::Series* series;
+        size_t begin;
+    };
+
+    size_t frames = messageBuffer.sizeAt(sequence);
+    // Plotted in seconds, frame timestamps are in ns
+    double first = frames > 0 ? messageBuffer.frame(0).timestamp / 1e9 : 0.0;
+    double last = frames > 0 ? messageBuffer.frame(frames - 1).timestamp / 1e9 : 1.0;
+
+    // Statistics of the samples in a plot window, extended while the window only grows at its end and
+    // rebuilt when its first sample changes by zooming, panning or frames being dropped
+    struct WindowStatistics {
+        size_t begin = 0;
+        size_t end = 0;
+        uint64_t firstTime = 0;
+        CAN::RunningStatistics statistics;
+    };
+    static std::unordered_map<std::string, WindowStatistics> windows;
+
+    auto statisticsRow = [](const std::string& label, const CAN::RunningStatistics* statistics) {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Text("%s", label.c_str());
+        if (!statistics || statistics->getCount() == 0) return;
+        const double values[] = {statistics->getMin(), statistics->getMax(), statistics->getMean(), statistics->getStddev(),
+                                 statistics->getQuantile(0), statistics->getQuantile(1), statistics->getQuantile(2)};
+        for (int i = 0; i < 7; ++i) {
+            ImGui::TableSetColumnIndex(i + 1);
+            ImGui::Text("%.4g", values[i]);
+        }
+    };
+
+    for (const auto& pair : *database) {
+        const CAN::MessageDescription& messageDescription = pair.second;
+        if (!messageDescription.plot) continue;
+
+        // The plot with the statistics of its signals beside it
+        if (!ImGui::BeginTable(("##plotRow" + std::to_string(messageDescription.id)).c_str(), 2)) continue;
+        ImGui::TableSetupColumn("Plot", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Statistics", ImGuiTableColumnFlags_WidthFixed, 440);
+        ImGui::TableNextColumn();
+
+        std::vector<const CAN::RunningStatistics*> visible(messageDescription.signals.size(), nullptr);
+        if (ImPlot::BeginPlot((int_to_hex(messageDescription.id, 2) + " " + messageDescription.name).c_str())) {
+            ImPlot::SetupAxes("Time (s)", "", ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit);
+            ImPlot::SetupAxisLimits(ImAxis_X1, first, last, fitAll ? ImPlotCond_Always : ImPlotCond_Once);
+
+            // Only the samples inside the zoomed window are handed to the plot
+            ImPlotRect limits = ImPlot::GetPlotLimits();
+            uint64_t t0 = limits.X.Min > 0 ? static_cast<uint64_t>(limits.X.Min * 1e9) : 0;
+            uint64_t t1 = limits.X.Max > 0 ? static_cast<uint64_t>(std::ceil(limits.X.Max * 1e9)) : 0;
+
+            for (size_t s = 0; s < messageDescription.signals.size(); ++s) {
+                const CAN::SignalDescription& signal = messageDescription.signals[s];
+                auto dataGetter = [](int idx, void* data) -> ImPlotPoint {
+                    auto* view = static_cast<const View*>(data);
+                    size_t index = view->begin + idx;
+                    return ImPlotPoint(view->series->time(index) / 1e9, view->series->value(index));
+                };
+
+                CAN::MessageBuffer::Series series = messageBuffer.series(messageDescription.id, signal.name, sequence);
+                CAN::MessageBuffer::Span span = series.range(t0, t1);
+                // One sample past each edge so lines run to the border
+                size_t begin = span.begin > 0 ? span.begin - 1 : 0;
+                size_t end = std::min(span.end + 1, series.size());
+                begin = std::min(begin, end);
+                View view{&series, begin};
+                ImPlot::PlotLineG(signal.name.c_str(), dataGetter, &view, static_cast<int>(end - begin));
+                if (messageDescription.id == spectrumID && signal.name == spectrumSignal) {
+                    spectrumFrom = t0;
+                    spectrumTo = t1;
                 }
 
-                ImPlot::EndPlot();
+                WindowStatistics& window = windows[std::to_string(messageDescription.id) + "." + signal.name];
+                bool grown = window.begin < window.end && span.begin == window.begin && span.end >= window.end &&
+                             series.time(window.begin) == window.firstTime;
+                if (!grown) {
+                    window = WindowStatistics();
+                    window.begin = window.end = span.begin;
+                    if (!span.empty()) window.firstTime = series.time(span.begin);
+                }
+                for (size_t i = window.end; i < span.end; ++i) {
+                    uint64_t time = series.time(i);
+                    if (time >= t0 && time <= t1) window.statistics.add(series.value(i));
+                }
+                window.end = span.end;
+                visible[s] = &window.statistics;
             }
+
+            ImPlot::EndPlot();
+        }
+
+        // Visible window first, then the whole capture since the message was plotted
+        ImGui::TableNextColumn();
+        if (ImGui::BeginTable(("##statistics" + std::to_string(messageDescription.id)).c_str(), 8, ImGuiTableFlags_SizingFixedFit)) {
+            const char* headers[] = {"Signal", "Min", "Max", "Mean", "SD", "P5", "P50", "P95"};
+            for (const char* header : headers) ImGui::TableSetupColumn(header);
+            ImGui::TableHeadersRow();
+            for (size_t s = 0; s < messageDescription.signals.size(); ++s) {
+                statisticsRow(messageDescription.signals[s].name, visible[s]);
+                statisticsRow("  all", signalStatistics.get(messageDescription.id, s));
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::EndTable();
+    }
+
+    if (!mathChannels.empty() && ImPlot::BeginPlot("Math channels")) {
+        ImPlot::SetupAxes("Time (s)", "", ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit);
+        ImPlot::SetupAxisLimits(ImAxis_X1, first, last, fitAll ? ImPlotCond_Always : ImPlotCond_Once);
+
+        ImPlotRect limits = ImPlot::GetPlotLimits();
+        uint64_t t0 = limits.X.Min > 0 ? static_cast<uint64_t>(limits.X.Min * 1e9) : 0;
+        uint64_t t1 = limits.X.Max > 0 ? static_cast<uint64_t>(std::ceil(limits.X.Max * 1e9)) : 0;
+
+        struct ChannelView {
+            const CAN::MathChannel* channel;
+            size_t begin;
+        };
+        auto dataGetter = [](int idx, void* data) -> ImPlotPoint {
+            auto* view = static_cast<const ChannelView*>(data);
+            size_t index = view->begin + idx;
+            return ImPlotPoint(view->channel->time(index) / 1e9, view->channel->value(index));
+        };
+
+        for (const CAN::MathChannel& channel : mathChannels) {
+            size_t samples = channel.sizeAt(sequence);
+            CAN::MathChannel::Span span = channel.range(t0, t1);
+            size_t begin = std::min(span.begin > 0 ? span.begin - 1 : 0, samples);
+            size_t end = std::min(span.end + 1, samples);
+            ChannelView view{&channel, begin};
+            ImPlot::PlotLineG(channel.getName().c_str(), dataGetter, &view, static_cast<int>(end - begin));
+        }
+
+        ImPlot::EndPlot();
+    }
+
+    if (!spectrum.empty() && ImPlot::BeginPlot(("Spectrum of " + spectrumSignal).c_str())) {
+        ImPlot::SetupAxes("Frequency (Hz)", "Amplitude", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+        ImPlot::SetupAxisScale(ImAxis_Y1, ImPlotScale_Log10);
+        auto binGetter = [](int idx, void* data) -> ImPlotPoint {
+            // Bin k of n samples at rate Hz is at k * rate / n
+            double binWidth = spectrumRate / ((spectrum.size() - 1) * 2);
+            return ImPlotPoint(idx * binWidth, spectrum[idx]);
+        };
+        ImPlot::PlotLineG(spectrumSignal.c_str(), binGetter, nullptr, static_cast<int>(spectrum.size()));
+        ImPlot::EndPlot();
+    }
+
+    if (spectrogram) {
+        static std::vector<float> rows;
+        float low, high;
+        size_t count = spectrogram->rows(rows, low, high);
+        if (count > 0 && ImPlot::BeginPlot("Spectrogram (dB)", ImVec2(-1, 300))) {
+            ImPlot::SetupAxes("Frequency (Hz)", "", ImPlotAxisFlags_None, ImPlotAxisFlags_NoTickLabels);
+            ImPlot::PushColormap(ImPlotColormap_Viridis);
+            // Oldest row at the top, 100 dB below the peak and less are the same color
+            ImPlot::PlotHeatmap("##spectrogram", rows.data(), static_cast<int>(count), static_cast<int>(spectrogram->bins()),
+                                std::max(low, high - 100.0f), high, nullptr, ImPlotPoint(0, 0), ImPlotPoint(spectrogram->getRate() / 2, count));
+            ImPlot::PopColormap();
+            ImPlot::EndPlot();
         }
     }
     ImGui::EndChild();
@@ -540,7 +1197,7 @@ void Window::createGraphTab() {
     ImGui::EndTabItem();
 }
 
-std::string Window::openFileDialog() {
+std::string Window::openFileDialog(const char* filter) {
     char filename[100] = "";
 
     HWND hwnd = glfwGetWin32Window(pWindow);
@@ -549,7 +1206,7 @@ std::string Window::openFileDialog() {
     ZeroMemory(&ofn, sizeof(ofn));
     ofn.lStructSize = sizeof(ofn);
     ofn.hwndOwner = hwnd;
-    ofn.lpstrFilter = "DBC Files\0*.dbc\0";
+    ofn.lpstrFilter = filter;
     ofn.lpstrFile = filename;
     ofn.nMaxFile = MAX_PATH;
     ofn.Flags = OFN_DONTADDTORECENT | OFN_FILEMUSTEXIST;
@@ -558,4 +1215,79 @@ std::string Window::openFileDialog() {
         return std::string(filename);
     }
     return ""; // Return an empty string if canceled
-}
\ No newline at end of file
+}
+
+void Window::createStatisticsTab() {
+    PROFILE_SCOPE("tab/statistics");
+    CAN::DatabaseSnapshot database = messageDatabase.snapshot();
+    ImGui::Text("%zu channels", busStatistics.size());
+    ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - 60);
+    if (ImGui::Button("Reset")) busStatistics.clear();
+
+    if (ImGui::BeginChild("StatisticsTable", ImVec2(0, 0), true, ImGuiWindowFlags_AlwaysVerticalScrollbar | ImGuiWindowFlags_NoBackground)) {
+        for (const auto& [number, bus] : busStatistics) {
+            ImGui::PushID(static_cast<int>(number));
+            if (!ImGui::CollapsingHeader(("Channel " + std::to_string(number)).c_str(), ImGuiTreeNodeFlags_DefaultOpen)) {
+                ImGui::PopID();
+                continue;
+            }
+
+            const CAN::ChannelStatistics& channel = bus.getChannel();
+            ImGui::Text("Bus load: %.1f %% (peak %.1f %%)", channel.load * 100, channel.peakLoad * 100);
+            ImGui::SameLine(300);
+            ImGui::Text("%.0f frames/s", channel.framesPerSecond);
+            ImGui::SameLine(450);
+            ImGui::Text("%llu frames, %llu error frames", static_cast<unsigned long long>(channel.frames), static_cast<unsigned long long>(channel.errorFrames));
+            if (channel.hasDriver) {
+                ImGui::Text("Driver: %lu overruns, %lu bus warnings, %lu bus off", channel.overruns, channel.busWarnings, channel.busOff);
+            }
+
+            if (ImGui::BeginTable("Statistics", 11, ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("ID", ImGuiTableColumnFlags_WidthFixed, 80);
+                ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 150);
+                ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed, 80);
+                ImGui::TableSetupColumn("Rate (1/s)", ImGuiTableColumnFlags_WidthFixed, 80);
+                ImGui::TableSetupColumn("Load (%)", ImGuiTableColumnFlags_WidthFixed, 70);
+                ImGui::TableSetupColumn("Cycle (ms)", ImGuiTableColumnFlags_WidthFixed, 80);
+                ImGui::TableSetupColumn("Min (ms)", ImGuiTableColumnFlags_WidthFixed, 70);
+                ImGui::TableSetupColumn("Max (ms)", ImGuiTableColumnFlags_WidthFixed, 70);
+                ImGui::TableSetupColumn("Jitter (ms)", ImGuiTableColumnFlags_WidthFixed, 80);
+                ImGui::TableSetupColumn("DLC", ImGuiTableColumnFlags_WidthFixed, 50);
+                ImGui::TableSetupColumn("Gaps");
+                ImGui::TableHeadersRow();
+
+                for (const CAN::IDStatistics& statistics : bus.getIDs()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("%s%s", int_to_hex(statistics.id, 2).c_str(), statistics.flags & MSG_FLAG_EXTENDED ? " EXT" : "");
+                    ImGui::TableSetColumnIndex(1);
+                    auto it = database->find(statistics.id);
+                    if (it != database->end()) ImGui::Text("%s", it->second.name.c_str());
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%llu", static_cast<unsigned long long>(statistics.count));
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%.1f", statistics.rate);
+                    ImGui::TableSetColumnIndex(4);
+                    ImGui::Text("%.2f", statistics.load * 100);
+                    ImGui::TableSetColumnIndex(5);
+                    ImGui::Text("%.2f", statistics.cycleMean / 1000);
+                    ImGui::TableSetColumnIndex(6);
+                    ImGui::Text("%.2f", statistics.cycleMin / 1000);
+                    ImGui::TableSetColumnIndex(7);
+                    ImGui::Text("%.2f", statistics.cycleMax / 1000);
+                    ImGui::TableSetColumnIndex(8);
+                    ImGui::Text("%.3f", statistics.jitter / 1000);
+                    ImGui::TableSetColumnIndex(9);
+                    ImGui::Text("%llu", static_cast<unsigned long long>(statistics.dlcViolations));
+                    ImGui::TableSetColumnIndex(10);
+                    ImGui::Text("%llu", static_cast<unsigned long long>(statistics.gaps));
+                }
+                ImGui::EndTable();
+            }
+            ImGui::PopID();
+        }
+        ImGui::EndChild();
+    }
+
+    ImGui::EndTabItem();
+}
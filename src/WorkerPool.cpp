@@ -0,0 +1,52 @@
+#include "WorkerPool.h"
+
+CAN::WorkerPool::WorkerPool(size_t workers) {
+    for (size_t worker = 1; worker < workers; ++worker) threads.emplace_back(&WorkerPool::work, this, worker);
+}
+
+CAN::WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+void CAN::WorkerPool::work(size_t worker) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        start.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+
+        const std::function<void(size_t)>* current = job;
+        lock.unlock();
+        (*current)(worker);
+        lock.lock();
+
+        if (--pending == 0) finished.notify_one();
+    }
+}
+
+void CAN::WorkerPool::run(const std::function<void(size_t)>& job) {
+    if (threads.empty()) {
+        job(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = &job;
+        pending = threads.size();
+        generation++;
+    }
+    start.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return pending == 0; });
+    this->job = nullptr;
+}
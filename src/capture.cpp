@@ -0,0 +1,260 @@
+#include "CAN.h"
+#include "Device.h"
+#include "Log.h"
+#include "Synthetic.h"
+#include "Statistics.h"
+#include "Filter.h"
+#include "Trigger.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <string>
+
+// Headless capture to the binary log format, one receive thread per channel
+
+static std::atomic<bool> running{true};
+
+static void usage() {
+    std::cerr << "Usage: canvis-capture [options] <channel>...\n"
+              << "  channel        canal:<device id>;<baudrate>, socketcan:<interface> or sim:<messages>\n"
+              << "  -o <basename>  Output file basename (default: capture)\n"
+              << "  -s <MB>        Start a new file after this many MB\n"
+              << "  -t <seconds>   Start a new file after this many seconds\n"
+              << "  -b <kbit/s>    Nominal bitrate for bus load (default: 500)\n"
+              << "  -d <kbit/s>    Data bitrate for bus load (default: 2000)\n"
+              << "  -f <filter>    Only capture frames matching the filter expression\n"
+              << "  -D <dbc>       Database for signal predicates in the filter\n"
+              << "  -T <trigger>   Only write the traffic around each time this expression becomes true\n"
+              << "  -p <seconds>   Pre-trigger window (default: 5)\n"
+              << "  -P <seconds>   Post-trigger window (default: 5)\n"
+              << "  -r <policy>    single, rearm or retrigger (default: single)\n"
+              << "  -H <seconds>   Holdoff before re-arming (default: 0)\n"
+              << "  -n <count>     Stop after this many triggers\n"
+              << "  -q             No periodic status output\n";
+}
+
+static std::unique_ptr<CAN::Device> openChannel(const std::string& channel) {
+    size_t colon = channel.find(':');
+    std::string type = channel.substr(0, colon);
+    std::string config = colon == std::string::npos ? "" : channel.substr(colon + 1);
+
+#ifdef CANVIS_WITH_CANAL
+    if (type == "canal") return std::make_unique<CAN::CanalDevice>(config);
+#endif
+#ifdef __linux__
+    if (type == "socketcan") return std::make_unique<CAN::SocketCANDevice>(config);
+#endif
+    if (type == "sim") {
+        CAN::SyntheticOptions options;
+        try {
+            if (!config.empty()) options.messages = std::stoul(config);
+        } catch (const std::logic_error&) {
+            throw std::runtime_error("Invalid message count: " + channel);
+        }
+        return std::make_unique<CAN::SimulatedDevice>(CAN::syntheticDatabase(options));
+    }
+    throw std::runtime_error("Unsupported channel: " + channel);
+}
+
+int main(int argc, char** argv) {
+    std::string basename = "capture";
+    uint64_t rotateSize = 0;
+    unsigned long rotateTime = 0;
+    bool quiet = false;
+    unsigned long bitrate = 500, dataBitrate = 2000;
+    std::string filterText, dbcFile, triggerText;
+    CAN::TriggerOptions triggerOptions;
+    std::vector<std::string> channels;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        // Numbers are parsed with std::stoul and friends, which throw on text that is not a number
+        try {
+            if (arg == "-o" && i + 1 < argc) basename = argv[++i];
+            else if (arg == "-s" && i + 1 < argc) rotateSize = std::stoull(argv[++i]) * 1024 * 1024;
+            else if (arg == "-t" && i + 1 < argc) rotateTime = std::stoul(argv[++i]);
+            else if (arg == "-b" && i + 1 < argc) bitrate = std::stoul(argv[++i]);
+            else if (arg == "-d" && i + 1 < argc) dataBitrate = std::stoul(argv[++i]);
+            else if (arg == "-f" && i + 1 < argc) filterText = argv[++i];
+            else if (arg == "-D" && i + 1 < argc) dbcFile = argv[++i];
+            else if (arg == "-T" && i + 1 < argc) triggerText = argv[++i];
+            else if (arg == "-p" && i + 1 < argc) triggerOptions.preTrigger = static_cast<uint64_t>(std::stod(argv[++i]) * 1e9);
+            else if (arg == "-P" && i + 1 < argc) triggerOptions.postTrigger = static_cast<uint64_t>(std::stod(argv[++i]) * 1e9);
+            else if (arg == "-H" && i + 1 < argc) triggerOptions.holdoff = static_cast<uint64_t>(std::stod(argv[++i]) * 1e9);
+            else if (arg == "-n" && i + 1 < argc) triggerOptions.maxTriggers = std::stoul(argv[++i]);
+            else if (arg == "-r" && i + 1 < argc) {
+                std::string policy = argv[++i];
+                if (policy == "single") triggerOptions.policy = TRIGGER_SINGLE;
+                else if (policy == "rearm") triggerOptions.policy = TRIGGER_REARM;
+                else if (policy == "retrigger") triggerOptions.policy = TRIGGER_RETRIGGER;
+                else {
+                    usage();
+                    return 1;
+                }
+            }
+            else if (arg == "-q") quiet = true;
+            else if (arg[0] == '-') {
+                usage();
+                return 1;
+            } else channels.push_back(arg);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            usage();
+            return 1;
+        }
+    }
+
+    if (channels.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<CAN::Device>> devices;
+    CAN::Database database;
+    CAN::Filter filter;
+    CAN::Filter trigger;
+    try {
+        if (!dbcFile.empty()) CAN::parseDBC(dbcFile, database);
+        filter = CAN::Filter(filterText, &database);
+        trigger = CAN::Filter(triggerText, &database);
+        for (const std::string& channel : channels) {
+            devices.push_back(openChannel(channel));
+            // Drivers that filter in hardware drop most non-matching frames before they reach us
+            devices.back()->setFilters(filter.getIDFilters());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // Either everything goes to rotating logs, or only the windows around triggers
+    std::unique_ptr<CAN::LogWriter> writer;
+    std::unique_ptr<CAN::TriggerCapture> triggerCapture;
+    try {
+        if (trigger.empty()) writer = std::make_unique<CAN::LogWriter>(basename, rotateSize, rotateTime);
+        else triggerCapture = std::make_unique<CAN::TriggerCapture>(basename, trigger, triggerOptions);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::mutex writerMutex;
+    std::string writeError; // First log write failure, under writerMutex
+    std::vector<CAN::BusStatistics> statistics(devices.size(), CAN::BusStatistics(nullptr, bitrate * 1000, dataBitrate * 1000));
+
+    std::signal(SIGINT, [](int) { running = false; });
+    std::signal(SIGTERM, [](int) { running = false; });
+
+    // Frames are written in batches, so the writer lock is taken once per batch rather than per frame
+    std::vector<std::thread> threads;
+    for (size_t channel = 0; channel < devices.size(); ++channel) {
+        threads.emplace_back([&, channel]() {
+            const size_t BATCH = 256;
+            std::vector<CAN::Frame> frames(BATCH);
+            std::vector<CAN::Frame> matched(filter.empty() ? 0 : BATCH);
+            CAN::Device& device = *devices[channel];
+
+            while (running) {
+                size_t count = device.receiveBatch(frames.data(), BATCH, 100);
+                if (count == 0) continue;
+
+                for (size_t i = 0; i < count; ++i) frames[i].obid = static_cast<unsigned long>(channel);
+
+                // Statistics see the whole bus, the log only what passes the filter
+                const CAN::Frame* output = frames.data();
+                size_t kept = count;
+                if (!filter.empty()) {
+                    kept = 0;
+                    for (size_t i = 0; i < count; ++i) {
+                        if (filter.matches(frames[i])) matched[kept++] = frames[i];
+                    }
+                    output = matched.data();
+                }
+
+                std::lock_guard<std::mutex> lock(writerMutex);
+                statistics[channel].add(frames.data(), count);
+                if (!writeError.empty()) break;
+                try {
+                    if (writer) writer->write(output, kept);
+                    else triggerCapture->add(output, kept);
+                } catch (const std::runtime_error& e) {
+                    // A full disk or a removed drive stops the capture rather than the process
+                    writeError = e.what();
+                    running = false;
+                }
+            }
+        });
+    }
+
+    uint64_t lastFrames = 0;
+    auto lastStatus = std::chrono::steady_clock::now();
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // Bounds what is lost on a crash
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!writeError.empty()) break;
+        try {
+            if (writer) writer->flush();
+            else if (triggerCapture->isDone()) running = false;
+        } catch (const std::runtime_error& e) {
+            writeError = e.what();
+            running = false;
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!quiet && now - lastStatus >= std::chrono::seconds(10)) {
+            double seconds = std::chrono::duration<double>(now - lastStatus).count();
+            if (writer) {
+                std::cerr << writer->framesWritten() << " frames, " << (writer->framesWritten() - lastFrames) / seconds
+                          << " frames/s -> " << writer->currentFile() << std::endl;
+                lastFrames = writer->framesWritten();
+            } else {
+                std::cerr << triggerCapture->getTriggers() << " triggers, "
+                          << (triggerCapture->isCapturing() ? "capturing" : triggerCapture->isArmed() ? "armed" : "holdoff") << std::endl;
+            }
+            for (size_t channel = 0; channel < devices.size(); ++channel) {
+                CANALSTATISTICS driver;
+                if (devices[channel]->getStatistics(driver) == CANAL_ERROR_SUCCESS) statistics[channel].merge(driver);
+
+                const CAN::ChannelStatistics& bus = statistics[channel].getChannel();
+                std::cerr << "  " << channels[channel] << ": " << bus.load * 100 << "% load, " << bus.framesPerSecond
+                          << " frames/s, " << bus.errorFrames << " error frames";
+                if (bus.hasDriver) std::cerr << ", " << bus.overruns << " overruns, " << bus.busOff << " bus off";
+                std::cerr << std::endl;
+            }
+            lastStatus = now;
+        }
+    }
+
+    running = false;
+    for (std::thread& thread : threads) thread.join();
+    if (writeError.empty()) {
+        try {
+            if (writer) writer->flush();
+            else triggerCapture->flush();
+        } catch (const std::runtime_error& e) {
+            writeError = e.what();
+        }
+    }
+
+    if (writer) {
+        std::cerr << writer->framesWritten() << " frames captured" << std::endl;
+    } else {
+        for (const std::string& file : triggerCapture->getFiles()) std::cerr << file << std::endl;
+        std::cerr << triggerCapture->getTriggers() << " triggers captured" << std::endl;
+    }
+    if (!writeError.empty()) {
+        std::cerr << writeError << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,17 +5,65 @@
 #include "usb2can.h"
 #include <vector>
 #include "CAN.h"
+#include "Profiler.h"
+#include <chrono>
+#include <algorithm>
 
 int main() {
     Window window(1280, 720, "CANVis");
+    auto lastDriverPoll = std::chrono::steady_clock::now();
+    std::vector<CAN::Frame> batch;
+
+    // Math channels get the same frames as the buffer, under the same sequence numbers. Their samples
+    // only cover the frames in memory and count against its budget.
+    auto store = [&](size_t count) {
+        uint64_t sequence = messageBuffer.getSequence();
+        messageBuffer.addMessages(batch.data(), count);
+        signalStatistics.add(batch.data(), count);
+        size_t derived = 0;
+        for (CAN::MathChannel& channel : mathChannels) {
+            channel.add(batch.data(), count, sequence);
+            channel.trim(messageBuffer.getMemorySequence());
+            derived += channel.memory();
+        }
+        messageBuffer.setDerivedMemory(derived);
+    };
 
     while (!window.exit()) {
-        if (handle > 0) {
-            CANALMSG msg;
+        if (device) {
+            PROFILE_SCOPE("main/ingest");
+            // Frames are received straight into the batch and stored together, so their signals can be
+            // decoded in parallel. A dropped frame is overwritten by the next one.
+            batch.resize(CAN::MessageBuffer::SEGMENT_FRAMES);
+            size_t count = 0;
+            uint64_t newest = 0;
+            while (device->receive(batch[count])) {
+                CAN::Frame& frame = batch[count];
+                newest = std::max(newest, frame.timestamp);
+                busStatistics.try_emplace(frame.obid, &messageDatabase, busBitrate, busDataBitrate).first->second.add(frame);
 
-            while (CanalDataAvailable(handle)) {
-                CanalReceive(handle, &msg);
-                if (!isPaused) messageBuffer.addMessage(msg);
+                if (!ingestFilter.empty()) {
+                    bool match = ingestFilter.matches(frame);
+                    if (filterTags && match) frame.flags |= MSG_FLAG_TAGGED;
+                    else if (!filterTags && !match) continue;
+                }
+                if (++count == batch.size()) {
+                    store(count);
+                    count = 0;
+                }
+            }
+            store(count);
+            if (newest != 0) Profiler::markIngest(newest);
+
+            // Overrun and bus off counters only exist on the driver side
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastDriverPoll >= std::chrono::seconds(1)) {
+                CANALSTATISTICS driver;
+                // The driver counts for the whole device, every channel of it shows the counters
+                if (device->getStatistics(driver) == CANAL_ERROR_SUCCESS) {
+                    for (auto& [channel, statistics] : busStatistics) statistics.merge(driver);
+                }
+                lastDriverPoll = now;
             }
         }
 
@@ -24,9 +72,9 @@ int main() {
 
     window.close();
 
-    if (CanalClose(handle) != 0) {
-        std::cerr << "Failed to close the CAN channel!" << std::endl;
-    }
+    transmitScheduler.stop();
+    bulkTransmitter.cancel();
+    device.reset();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "MessageBuffer.h"
+#include "Database.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Checks that a series frozen at a sequence number keeps its indices below its size when queried by time,
+// also for windows past the frames it holds, and that signals keep their values when a new database
+// drops or reorders them mid-segment
+
+static size_t failures = 0;
+
+static void check(bool ok, const char* what, size_t frames, size_t cut) {
+    if (ok) return;
+    if (++failures <= 20) std::printf("FAIL %s: %zu frames, cut at %zu\n", what, frames, cut);
+}
+
+static CAN::SignalDescription describe(const char* name, int startBit, size_t length) {
+    CAN::SignalDescription sigDes;
+    sigDes.name = name;
+    sigDes.startBit = startBit;
+    sigDes.length = length;
+    sigDes.endianess = SIGNAL_LITTLE_ENDIAN;
+    sigDes.signedness = false;
+    sigDes.scale = 1;
+    sigDes.offset = 0;
+    sigDes.min = 0;
+    sigDes.max = 0;
+    sigDes.compile();
+    return sigDes;
+}
+
+static CAN::Database database(const std::vector<CAN::SignalDescription>& signals) {
+    CAN::MessageDescription description;
+    description.id = 0x100;
+    description.name = "Counter";
+    description.length = CLASSIC_DATA_LENGTH;
+    description.signals = signals;
+
+    CAN::Database database;
+    database[description.id] = description;
+    return database;
+}
+
+// Frames of id 0x100 every µs, with a second id in between that the series skips
+static std::vector<CAN::Frame> frames(size_t count) {
+    std::vector<CAN::Frame> frames(count);
+    for (size_t i = 0; i < count; ++i) {
+        frames[i].id = i % 3 == 2 ? 0x200 : 0x100;
+        frames[i].sizeData = CLASSIC_DATA_LENGTH;
+        for (size_t byte = 0; byte < 4; ++byte) frames[i].data[byte] = static_cast<uint8_t>(i >> (8 * byte));
+        frames[i].timestamp = i * 1000;
+    }
+    return frames;
+}
+
+static void checkPaused(const CAN::DatabaseStore& store, const std::vector<CAN::Frame>& all, size_t held) {
+    CAN::MessageBuffer buffer(size_t(1) << 30, &store);
+    buffer.addMessages(all.data(), held);
+    uint64_t sequence = buffer.getSequence();
+    buffer.addMessages(all.data() + held, all.size() - held);
+
+    CAN::MessageBuffer::Series series = buffer.series(0x100, "counter", sequence);
+    size_t expected = 0;
+    for (size_t i = 0; i < held; ++i) expected += all[i].id == 0x100;
+    check(series.size() == expected, "paused size", all.size(), held);
+
+    uint64_t last = all.back().timestamp;
+    uint64_t cut = held > 0 ? all[held - 1].timestamp : 0;
+    const uint64_t windows[][2] = {{0, UINT64_MAX}, {0, last}, {cut / 2, cut}, {cut, last}, {cut + 1, last}, {last, last}};
+    for (const auto& window : windows) {
+        CAN::MessageBuffer::Span span = series.range(window[0], window[1]);
+        check(span.begin <= span.end && span.end <= series.size(), "span within the series", all.size(), held);
+        if (span.end > series.size()) continue;
+        for (size_t i = span.begin; i < span.end; ++i) {
+            uint64_t time = series.time(i);
+            check(time >= window[0] && time <= window[1], "time within the window", all.size(), held);
+            check(series.value(i) == static_cast<double>(time / 1000), "value", all.size(), held);
+        }
+        // Every value in the window is inside the span, the timestamps are in order
+        size_t inside = 0;
+        for (size_t i = 0; i < series.size(); ++i) {
+            uint64_t time = series.time(i);
+            inside += time >= window[0] && time <= window[1];
+        }
+        check(inside == span.size(), "span covers the window", all.size(), held);
+    }
+}
+
+// Bytes 4 to 6 hold 1, 2 and 3, read as signals a, b and c. The second half of the frames is decoded
+// without b and with c before a.
+static void checkLayout(size_t frames, size_t change) {
+    CAN::DatabaseStore store(database({describe("a", 32, 8), describe("b", 40, 8), describe("c", 48, 8)}));
+    std::vector<CAN::Frame> all(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        all[i].id = 0x100;
+        all[i].sizeData = CLASSIC_DATA_LENGTH;
+        all[i].data[4] = 1;
+        all[i].data[5] = 2;
+        all[i].data[6] = 3;
+        all[i].timestamp = i * 1000;
+    }
+
+    CAN::MessageBuffer buffer(size_t(1) << 30, &store);
+    buffer.addMessages(all.data(), change);
+    store.publish(database({describe("c", 48, 8), describe("a", 32, 8)}));
+    buffer.addMessages(all.data() + change, frames - change);
+
+    CAN::MessageBuffer::Series a = buffer.series(0x100, "a"), b = buffer.series(0x100, "b"), c = buffer.series(0x100, "c");
+    for (size_t i = 0; i < frames; ++i) {
+        check(a.value(i) == 1 && c.value(i) == 3, "kept signal", frames, change);
+        check(i < change ? b.value(i) == 2 : std::isnan(b.value(i)), "dropped signal", frames, change);
+    }
+}
+
+int main() {
+    CAN::DatabaseStore store(database({describe("counter", 0, 32)}));
+    std::vector<CAN::Frame> all = frames(3 * CAN::MessageBuffer::SEGMENT_FRAMES);
+
+    size_t checks = 0;
+    for (size_t held : {size_t(0), size_t(1), size_t(150), size_t(4095), size_t(4096), size_t(4097), size_t(6000), all.size() - 1}) {
+        checkPaused(store, all, held);
+        checks++;
+    }
+    checkLayout(200, 100);
+    checkLayout(2 * CAN::MessageBuffer::SEGMENT_FRAMES, CAN::MessageBuffer::SEGMENT_FRAMES + 10);
+
+    std::printf("%zu pauses, %zu failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
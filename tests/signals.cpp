@@ -0,0 +1,183 @@
+#include "CAN.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Checks extractRaw, decodeSignal and insertSignal against a bit by bit reference for every start bit
+// and length, both byte orders, signed, unsigned, float and double signals
+
+static size_t failures = 0;
+
+static void check(bool ok, const char* what, const CAN::SignalDescription& sigDes, size_t size) {
+    if (ok) return;
+    if (++failures <= 20) {
+        std::printf("FAIL %s: %s start %d length %zu %s size %zu\n", what, sigDes.endianess == SIGNAL_LITTLE_ENDIAN ? "Intel" : "Motorola",
+                    sigDes.startBit, sigDes.length, sigDes.signedness ? "signed" : "unsigned", size);
+    }
+}
+
+// Payload bit of each signal bit, LSB first, counted as byte * 8 + bit
+static std::vector<size_t> bitPositions(const CAN::SignalDescription& sigDes) {
+    std::vector<size_t> positions(sigDes.length);
+    if (sigDes.endianess == SIGNAL_LITTLE_ENDIAN) {
+        for (size_t i = 0; i < sigDes.length; ++i) positions[i] = sigDes.startBit + i;
+    } else {
+        // Motorola: startBit is the MSB, later bits continue from bit 7 of the next byte
+        size_t sequential = (sigDes.startBit / 8) * 8 + (7 - sigDes.startBit % 8);
+        for (size_t i = 0; i < sigDes.length; ++i) {
+            size_t position = sequential + sigDes.length - 1 - i;
+            positions[i] = (position / 8) * 8 + (7 - position % 8);
+        }
+    }
+    return positions;
+}
+
+static uint64_t extractBits(const uint8_t* data, size_t size, const CAN::SignalDescription& sigDes) {
+    std::vector<size_t> positions = bitPositions(sigDes);
+    uint64_t value = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (positions[i] / 8 < size) value |= static_cast<uint64_t>((data[positions[i] / 8] >> (positions[i] % 8)) & 1) << i;
+    }
+    return value;
+}
+
+static CAN::SignalDescription describe(int startBit, size_t length, bool endianess, bool signedness, int valueType) {
+    CAN::SignalDescription sigDes;
+    sigDes.name = "signal";
+    sigDes.startBit = startBit;
+    sigDes.length = length;
+    sigDes.endianess = endianess;
+    sigDes.signedness = signedness;
+    sigDes.scale = 1;
+    sigDes.offset = 0;
+    sigDes.min = 0;
+    sigDes.max = 0;
+    sigDes.valueType = valueType;
+    sigDes.compile();
+    return sigDes;
+}
+
+static double toDouble(const CAN::Signal& signal) {
+    return std::visit([](auto value) { return static_cast<double>(value); }, signal);
+}
+
+static bool same(double a, double b) {
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// Raw pattern of length bits that converts to a double and back exactly
+static uint64_t exactRaw(std::mt19937_64& random, const CAN::SignalDescription& sigDes) {
+    uint64_t mask = sigDes.length == 64 ? ~0ULL : (1ULL << sigDes.length) - 1;
+    uint64_t raw = random() & mask;
+    if (sigDes.valueType == SIG_INTEGER && sigDes.length > 53) raw &= ~((1ULL << (sigDes.length - 53)) - 1);
+    return raw;
+}
+
+static double physical(uint64_t raw, const CAN::SignalDescription& sigDes) {
+    if (sigDes.valueType == SIG_FLOAT && sigDes.length == 32) {
+        float f;
+        uint32_t bits = static_cast<uint32_t>(raw);
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+    if (sigDes.valueType == SIG_DOUBLE && sigDes.length == 64) {
+        double d;
+        std::memcpy(&d, &raw, sizeof(d));
+        return d;
+    }
+    if (sigDes.signedness) {
+        int shift = 64 - static_cast<int>(sigDes.length);
+        return static_cast<double>(static_cast<int64_t>(raw << shift) >> shift);
+    }
+    return static_cast<double>(raw);
+}
+
+static void checkSignal(std::mt19937_64& random, const CAN::SignalDescription& sigDes, size_t size) {
+    uint8_t data[MAX_DATA_LENGTH];
+    for (uint8_t& byte : data) byte = static_cast<uint8_t>(random());
+
+    uint64_t reference = extractBits(data, size, sigDes);
+    check(CAN::extractRaw(data, size, sigDes) == reference, "extractRaw", sigDes, size);
+    check(same(toDouble(CAN::decodeSignal(sigDes, data, size)), physical(reference, sigDes)), "decodeSignal", sigDes, size);
+
+    // Bits past the end of the payload are dropped, the others must come back and nothing else may change
+    uint64_t raw = exactRaw(random, sigDes);
+    double value = physical(raw, sigDes);
+    if (std::isnan(value)) return;
+
+    uint8_t inserted[MAX_DATA_LENGTH];
+    std::memcpy(inserted, data, sizeof(data));
+    CAN::insertSignal(inserted, size, sigDes, value);
+
+    uint64_t present = 0;
+    std::vector<size_t> positions = bitPositions(sigDes);
+    std::vector<bool> owned(MAX_DATA_LENGTH * 8, false);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (positions[i] / 8 >= size) continue;
+        present |= 1ULL << i;
+        owned[positions[i]] = true;
+    }
+    check(extractBits(inserted, size, sigDes) == (raw & present), "insertSignal", sigDes, size);
+
+    bool kept = true;
+    for (size_t bit = 0; bit < MAX_DATA_LENGTH * 8; ++bit) {
+        if (owned[bit]) continue;
+        kept = kept && ((inserted[bit / 8] ^ data[bit / 8]) & (1 << (bit % 8))) == 0;
+    }
+    check(kept, "insertSignal keeps other bits", sigDes, size);
+}
+
+int main() {
+    std::mt19937_64 random(26);
+    size_t signals = 0;
+
+    for (size_t size : {size_t(CLASSIC_DATA_LENGTH), size_t(MAX_DATA_LENGTH)}) {
+        for (bool endianess : {SIGNAL_LITTLE_ENDIAN, SIGNAL_BIG_ENDIAN}) {
+            for (int startBit = 0; startBit < static_cast<int>(size * 8); ++startBit) {
+                for (size_t length = 1; length <= 64; ++length) {
+                    for (bool signedness : {false, true}) {
+                        CAN::SignalDescription sigDes = describe(startBit, length, endianess, signedness, SIG_INTEGER);
+                        for (int i = 0; i < 2; ++i) checkSignal(random, sigDes, size);
+                        signals++;
+                    }
+                }
+
+                CAN::SignalDescription single = describe(startBit, 32, endianess, true, SIG_FLOAT);
+                CAN::SignalDescription dual = describe(startBit, 64, endianess, true, SIG_DOUBLE);
+                for (int i = 0; i < 2; ++i) {
+                    checkSignal(random, single, size);
+                    checkSignal(random, dual, size);
+                }
+                signals += 2;
+            }
+        }
+    }
+
+    // Scale and offset apply to the sign extended value
+    CAN::SignalDescription scaled = describe(12, 10, SIGNAL_LITTLE_ENDIAN, true, SIG_INTEGER);
+    scaled.scale = 0.5f;
+    scaled.offset = -40;
+    uint8_t data[CLASSIC_DATA_LENGTH] = {};
+    CAN::insertSignal(data, sizeof(data), scaled, -100);
+    check(CAN::extractRaw(data, sizeof(data), scaled) == 0x388, "scaled insertSignal", scaled, sizeof(data));
+    check(toDouble(CAN::decodeSignal(scaled, data, sizeof(data))) == -100, "scaled decodeSignal", scaled, sizeof(data));
+
+    // Out of range values saturate to the extremes of the bit pattern, also where they are not doubles
+    for (size_t length : {size_t(8), size_t(53), size_t(54), size_t(63), size_t(64)}) {
+        for (bool signedness : {false, true}) {
+            CAN::SignalDescription wide = describe(0, length, SIGNAL_LITTLE_ENDIAN, signedness, SIG_INTEGER);
+            uint64_t mask = length == 64 ? ~0ULL : (1ULL << length) - 1;
+            uint8_t payload[CLASSIC_DATA_LENGTH] = {};
+            CAN::insertSignal(payload, sizeof(payload), wide, 1e30);
+            check(CAN::extractRaw(payload, sizeof(payload), wide) == (signedness ? mask >> 1 : mask), "insertSignal saturates high", wide, sizeof(payload));
+            CAN::insertSignal(payload, sizeof(payload), wide, -1e30);
+            check(CAN::extractRaw(payload, sizeof(payload), wide) == (signedness ? (mask >> 1) + 1 : 0), "insertSignal saturates low", wide, sizeof(payload));
+        }
+    }
+
+    std::printf("%zu signals, %zu failures\n", signals, failures);
+    return failures == 0 ? 0 : 1;
+}